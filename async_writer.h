@@ -0,0 +1,134 @@
+#ifndef ASYNC_WRITER_H
+#define ASYNC_WRITER_H
+#include <cstddef> //needed for size_t
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <atomic>
+#include "trajectory.h"
+
+// Trajectory output off the integrator's thread.
+// capture() encodes a snapshot into the next free buffer of a ring and
+// returns; a background thread takes every filled buffer at once and hands
+// them to the trajectory_writer as one writev. Buffers keep their capacity,
+// so after the first lap no snapshot allocates. capture() only waits when
+// every buffer is still queued, i.e. when the disk cannot keep up; those
+// waits are counted in stalls().
+class async_trajectory_writer {
+public:
+    // every: capture() ignores steps that are not a multiple of it
+    // buffers: snapshots that can be queued before capture() waits
+    async_trajectory_writer(const std::string& path, uint32_t fields, double dt, int every, size_t buffers = 4)
+        : writer(path, fields, dt), every(every), ring(buffers < 2 ? 2 : buffers) {
+        thread = std::thread([this] { drain(); });
+    }
+
+    async_trajectory_writer(const async_trajectory_writer&) = delete;
+    async_trajectory_writer& operator=(const async_trajectory_writer&) = delete;
+
+    ~async_trajectory_writer() {
+        try {
+            close();
+        } catch (...) {
+            // Destructors must not throw; an explicit close() reports errors
+        }
+    }
+
+    // Queue a snapshot of particles if step is an output step.
+    // Returns true if one was queued.
+    template <typename Container>
+    bool capture(uint64_t step, const Container& particles) {
+        if (every <= 0 || step % every != 0) return false;
+        size_t slot;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (filled == ring.size()) {
+                stalled++;
+                drained.wait(lock, [this] { return filled < ring.size() || failure; });
+            }
+            if (failure) std::rethrow_exception(failure);
+            slot = (head + filled) % ring.size();
+        }
+        // Only this thread touches a slot between taking it and publishing it
+        encodeFrame(step, particles, writer.fields(), ring[slot]);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            filled++;
+        }
+        ready.notify_one();
+        return true;
+    }
+
+    // Write out everything queued, stop the thread and close the file
+    void close() {
+        if (!thread.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        ready.notify_one();
+        thread.join();
+        if (failure) std::rethrow_exception(failure);
+        writer.close();
+    }
+
+    uint64_t stalls() const { return stalled; }
+    // Frames written so far; safe to call while the writer runs
+    uint64_t frames() const { return written; }
+
+private:
+    trajectory_writer writer; // Only used by the background thread until close()
+    int every;
+    std::vector<std::vector<char>> ring;
+    size_t head = 0;   // Oldest queued buffer
+    size_t filled = 0; // Queued buffers, head onwards
+    bool stopping = false;
+    std::exception_ptr failure;
+    std::atomic<uint64_t> stalled{0};
+    std::atomic<uint64_t> written{0}; // writer's own count is the drain thread's
+    std::mutex mutex;
+    std::condition_variable ready, drained;
+    std::thread thread;
+
+    void drain() {
+        std::vector<iovec> parts;
+        while (true) {
+            size_t first, count;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                ready.wait(lock, [this] { return filled > 0 || stopping; });
+                if (filled == 0) return; // Stopping with nothing left
+                first = head;
+                count = filled;
+            }
+            // Everything queued goes out as one write
+            parts.clear();
+            for (size_t k = 0; k < count; ++k) {
+                std::vector<char>& buffer = ring[(first + k) % ring.size()];
+                parts.push_back({buffer.data(), buffer.size()});
+            }
+            try {
+                writer.writeEncoded(parts.data(), static_cast<int>(parts.size()));
+                written += count;
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                failure = std::current_exception();
+                filled = 0;
+                drained.notify_all();
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                head = (head + count) % ring.size();
+                filled -= count;
+            }
+            drained.notify_one();
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,217 @@
+#ifndef BARNES_HUT_H
+#define BARNES_HUT_H
+#include <cstddef> //needed for size_t
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include "particle.h"
+#include "thread_pool.h"
+#include "cell_list.h"
+#include "space_filling.h"
+
+// Long-range 1/r^2 interaction (gravity for positive G, like charges for
+// negative G) between unit-mass particles, with Plummer softening.
+struct tree_params {
+    double G = 1e-5;         // Coupling strength
+    double softening = 0.01; // Plummer softening length
+    double theta = 0.5;      // Opening angle: a node is used whole if size < theta * distance
+    size_t leafSize = 8;     // Nodes with at most this many particles are not split
+    // Nodes straddling the seam half a box away from a particle, where the
+    // nearest image of their members flips side, are opened down to this
+    // size. Smaller follows the direct minimum-image sum more closely, at a
+    // cost that grows towards O(N^1.5) as it approaches the leaf size.
+    double seamSize = 1.0 / 16;
+};
+
+// Quadtree stored as a flat array of nodes in depth-first order.
+// Particles are sorted by Morton key, so every node covers a contiguous run
+// of them and its children follow it directly in the array. next is the
+// index just past the node's subtree, so a traversal never needs pointers or
+// a stack: descend with i + 1, skip with next. A node is a leaf when
+// next == i + 1.
+class barnes_hut {
+public:
+    struct node {
+        double x, y;    // Centre of mass
+        double mass;
+        double size;    // Side length of the node's square
+        uint32_t first; // Particles [first, first + count) in sorted order
+        uint32_t count;
+        uint32_t next;  // First node after this subtree
+    };
+
+    std::vector<node> nodes;
+    std::vector<size_t> order; // Container index of each sorted particle
+    std::vector<double> x, y;  // Positions in sorted order
+
+    // Rebuild the tree from the active particles
+    template <typename Container>
+    void build(const Container& particles, size_t leafSize, thread_pool& pool) {
+        keys.clear();
+        order.clear();
+        for (size_t i = 0; i < particles.size(); ++i) {
+            const Particle& p = particles[i];
+            if (p.active != Active) continue;
+            keys.push_back(curveKey(Morton, p.position[0], p.position[1]));
+            order.push_back(i);
+        }
+        radixSort(keys, order, pool);
+
+        size_t n = keys.size();
+        x.resize(n);
+        y.resize(n);
+        for (size_t s = 0; s < n; ++s) {
+            x[s] = particles[order[s]].position[0];
+            y[s] = particles[order[s]].position[1];
+        }
+
+        nodes.clear();
+        if (n > 0) buildNode(0, static_cast<uint32_t>(n), 0, leafSize);
+    }
+
+private:
+    std::vector<uint32_t> keys; // Morton key of each sorted particle
+
+    // Append the node for sorted particles [first, first + count) at the
+    // given depth, followed by its subtree, and return its index
+    uint32_t buildNode(uint32_t first, uint32_t count, int level, size_t leafSize) {
+        uint32_t index = static_cast<uint32_t>(nodes.size());
+        nodes.push_back({0.0, 0.0, 0.0, std::ldexp(1.0, -level), first, count, 0});
+
+        double mx = 0.0, my = 0.0, mass = 0.0;
+        if (count <= leafSize || level == 16) {
+            // Leaf: the particles do not wrap inside a node, so a plain
+            // average is the centre of mass
+            for (uint32_t s = first; s < first + count; ++s) {
+                mx += x[s];
+                my += y[s];
+            }
+            mass = count;
+        } else {
+            // Children are the runs sharing the next two bits of the key
+            int shift = 2 * (15 - level);
+            uint32_t begin = first, end = first + count;
+            while (begin < end) {
+                uint32_t quadrant = (keys[begin] >> shift) & 3;
+                uint32_t split = begin;
+                while (split < end && ((keys[split] >> shift) & 3) == quadrant) split++;
+                uint32_t child = buildNode(begin, split - begin, level + 1, leafSize);
+                mx += nodes[child].x * nodes[child].mass;
+                my += nodes[child].y * nodes[child].mass;
+                mass += nodes[child].mass;
+                begin = split;
+            }
+        }
+        node& self = nodes[index];
+        self.mass = mass;
+        self.x = mx / mass;
+        self.y = my / mass;
+        self.next = static_cast<uint32_t>(nodes.size());
+        return index;
+    }
+};
+
+// Fill accNext of every active particle with the long-range acceleration
+// from all others, approximating distant nodes by their centre of mass.
+// Separations use the nearest periodic image of each node. The tree is
+// rebuilt on every call; the walk is parallel over particles in Morton
+// order, so neighbouring threads read neighbouring parts of the tree.
+// Returns the total potential energy.
+template <typename Container>
+double computeGravity(Container& particles, const tree_params& params, barnes_hut& tree, thread_pool& pool) {
+    tree.build(particles, params.leafSize, pool);
+    double theta2 = params.theta * params.theta;
+    double eps2 = params.softening * params.softening;
+    const auto& nodes = tree.nodes;
+    uint32_t nnodes = static_cast<uint32_t>(nodes.size());
+
+    std::vector<double> energy(pool.size(), 0.0);
+    pool.parallel_for(tree.order.size(), [&](size_t t, size_t begin, size_t end) {
+        double localEnergy = 0.0;
+        for (size_t s = begin; s < end; ++s) {
+            double px = tree.x[s], py = tree.y[s];
+            double ax = 0.0, ay = 0.0, phi = 0.0;
+            // Pull towards a mass at separation (dx, dy)
+            auto add = [&](double dx, double dy, double mass) {
+                double r2 = dx * dx + dy * dy + eps2;
+                double inv = 1.0 / std::sqrt(r2);
+                double gm = params.G * mass * inv;
+                ax += gm * inv * inv * dx;
+                ay += gm * inv * inv * dy;
+                phi -= gm;
+            };
+
+            uint32_t i = 0;
+            while (i < nnodes) {
+                const auto& nd = nodes[i];
+                double dx = minimumImage(nd.x - px);
+                double dy = minimumImage(nd.y - py);
+                // A node must be opened if it holds the particle itself, or
+                // if it is still large and might reach past half a box away,
+                // where its members have nearer images than its centre does
+                bool seam = std::fabs(dx) + nd.size > 0.5 || std::fabs(dy) + nd.size > 0.5;
+                bool open = (s >= nd.first && s < nd.first + nd.count) ||
+                            (seam && nd.size > params.seamSize);
+                if (nd.next == i + 1) {
+                    for (uint32_t k = nd.first; k < nd.first + nd.count; ++k) {
+                        if (k == s) continue;
+                        add(minimumImage(tree.x[k] - px), minimumImage(tree.y[k] - py), 1.0);
+                    }
+                    i = nd.next;
+                } else if (!open && nd.size * nd.size < theta2 * (dx * dx + dy * dy)) {
+                    add(dx, dy, nd.mass);
+                    i = nd.next;
+                } else {
+                    i++; // Open the node
+                }
+            }
+
+            Particle& p = particles[tree.order[s]];
+            p.accNext[0] = ax;
+            p.accNext[1] = ay;
+            localEnergy += 0.5 * phi; // Each pair is counted from both ends
+        }
+        energy[t] = localEnergy;
+    });
+
+    double total = 0.0;
+    for (double e : energy) total += e;
+    return total;
+}
+
+// Direct O(N^2) sum of the same interaction, for checking the tree
+template <typename Container>
+double computeGravityDirect(Container& particles, const tree_params& params, thread_pool& pool) {
+    double eps2 = params.softening * params.softening;
+    size_t n = particles.size();
+    std::vector<double> energy(pool.size(), 0.0);
+    pool.parallel_for(n, [&](size_t t, size_t begin, size_t end) {
+        double localEnergy = 0.0;
+        for (size_t i = begin; i < end; ++i) {
+            Particle& p = particles[i];
+            if (p.active != Active) continue;
+            double ax = 0.0, ay = 0.0;
+            for (size_t j = 0; j < n; ++j) {
+                const Particle& q = particles[j];
+                if (j == i || q.active != Active) continue;
+                double dx = minimumImage(q.position[0] - p.position[0]);
+                double dy = minimumImage(q.position[1] - p.position[1]);
+                double inv = 1.0 / std::sqrt(dx * dx + dy * dy + eps2);
+                double gm = params.G * inv;
+                ax += gm * inv * inv * dx;
+                ay += gm * inv * inv * dy;
+                localEnergy -= 0.5 * gm;
+            }
+            p.accNext[0] = ax;
+            p.accNext[1] = ay;
+        }
+        energy[t] = localEnergy;
+    });
+
+    double total = 0.0;
+    for (double e : energy) total += e;
+    return total;
+}
+
+#endif
@@ -0,0 +1,194 @@
+#ifndef CELL_LIST_H
+#define CELL_LIST_H
+#include <cstddef> //needed for size_t
+#include <cmath>
+#include <algorithm>
+#include <vector>
+#include "particle.h"
+#include "thread_pool.h"
+
+// Short-range pair potentials. Particles have unit mass so the force is
+// written straight into accNext.
+struct force_params {
+    enum Kind {
+        SoftSphere,  // U = epsilon * (1 - r/sigma)^2 for r < sigma
+        LennardJones // U = 4 epsilon ((sigma/r)^12 - (sigma/r)^6) for r < cutoff
+    };
+    Kind kind = SoftSphere;
+    double epsilon = 1e-3; // Soft enough that a collision spans tens of dt = 0.01 steps
+    double sigma = 0.01;
+    double cutoff = 0.01; // SoftSphere ignores this and uses sigma
+
+    double range() const { return kind == SoftSphere ? sigma : cutoff; }
+};
+
+// Shortest periodic separation along one axis of the unit box
+inline double minimumImage(double d) {
+    if (d > 0.5) d -= 1.0;
+    if (d < -0.5) d += 1.0;
+    return d;
+}
+
+// Magnitude of the pair force divided by r, and the pair energy, at
+// squared separation r2 (which must be inside the range)
+inline double pairForce(const force_params& params, double r2, double& energy) {
+    if (params.kind == force_params::SoftSphere) {
+        double r = std::sqrt(r2);
+        double overlap = 1.0 - r / params.sigma;
+        energy = params.epsilon * overlap * overlap;
+        return r > 0 ? 2.0 * params.epsilon * overlap / (params.sigma * r) : 0.0;
+    }
+    // Coincident particles have no direction to push along, so like the
+    // soft-sphere case they exert nothing rather than inf/NaN
+    if (r2 <= 0.0) {
+        energy = 0.0;
+        return 0.0;
+    }
+    double s2 = params.sigma * params.sigma / r2;
+    double s6 = s2 * s2 * s2;
+    energy = 4.0 * params.epsilon * (s6 * s6 - s6);
+    return 24.0 * params.epsilon * (2.0 * s6 * s6 - s6) / r2;
+}
+
+// Uniform grid of cells over the periodic unit box.
+// build() bins the active particles with a counting sort and keeps a copy of
+// their positions in cell order so the pair loop streams through memory.
+class cell_list {
+public:
+    int ncell = 0;                 // Cells per side
+    std::vector<size_t> cell_start; // Particles of cell c are [cell_start[c], cell_start[c+1])
+    std::vector<size_t> order;      // Container index of each binned particle
+    std::vector<double> x, y;       // Positions in binned order
+
+    // Cells are at least range wide so only the 3x3 block around a
+    // particle's cell can hold partners
+    template <typename Container>
+    void build(const Container& particles, double range) {
+        ncell = static_cast<int>(1.0 / range);
+        if (ncell < 3) ncell = 1;   // Too few cells for a 3x3 stencil to be distinct
+        size_t ncells = static_cast<size_t>(ncell) * ncell;
+        size_t n = particles.size();
+
+        cell_of.resize(n);
+        cell_start.assign(ncells + 1, 0);
+        for (size_t i = 0; i < n; ++i) {
+            const Particle& p = particles[i];
+            if (p.active != Active) {
+                cell_of[i] = ncells; // Not binned
+                continue;
+            }
+            cell_of[i] = cellIndex(p.position[0], p.position[1]);
+            cell_start[cell_of[i] + 1]++;
+        }
+        for (size_t c = 0; c < ncells; ++c) {
+            cell_start[c + 1] += cell_start[c];
+        }
+        size_t binned = cell_start[ncells];
+        order.resize(binned);
+        x.resize(binned);
+        y.resize(binned);
+        fill.assign(cell_start.begin(), cell_start.end() - 1);
+        for (size_t i = 0; i < n; ++i) {
+            if (cell_of[i] == ncells) continue;
+            size_t slot = fill[cell_of[i]]++;
+            order[slot] = i;
+            x[slot] = particles[i].position[0];
+            y[slot] = particles[i].position[1];
+        }
+    }
+
+    size_t cellIndex(double px, double py) const {
+        // Clamp so a particle that overshot the box still lands in a valid cell
+        int cx = static_cast<int>(std::clamp(px * ncell, 0.0, ncell - 1.0));
+        int cy = static_cast<int>(std::clamp(py * ncell, 0.0, ncell - 1.0));
+        return static_cast<size_t>(cy) * ncell + cx;
+    }
+
+    // Number of binned particles in the 3x3 block of cells around (cx, cy),
+    // an upper bound on the partners forEachNeighbour() can visit
+    size_t stencilSize(int cx, int cy) const {
+        if (ncell == 1) return order.size();
+        size_t count = 0;
+        for (int dy = -1; dy <= 1; ++dy) {
+            int ny = (cy + dy + ncell) % ncell;
+            for (int dx = -1; dx <= 1; ++dx) {
+                int nx = (cx + dx + ncell) % ncell;
+                size_t c = static_cast<size_t>(ny) * ncell + nx;
+                count += cell_start[c + 1] - cell_start[c];
+            }
+        }
+        return count;
+    }
+
+    // Call f(slot, other) for every other binned particle in the 3x3 block
+    // of cells around binned particle slot, which lies in cell (cx, cy)
+    template <typename F>
+    void forEachNeighbour(int cx, int cy, size_t slot, F f) const {
+        if (ncell == 1) {
+            for (size_t j = 0; j < order.size(); ++j) {
+                if (j != slot) f(j);
+            }
+            return;
+        }
+        for (int dy = -1; dy <= 1; ++dy) {
+            int ny = (cy + dy + ncell) % ncell;
+            for (int dx = -1; dx <= 1; ++dx) {
+                int nx = (cx + dx + ncell) % ncell;
+                size_t c = static_cast<size_t>(ny) * ncell + nx;
+                for (size_t j = cell_start[c]; j < cell_start[c + 1]; ++j) {
+                    if (j != slot) f(j);
+                }
+            }
+        }
+    }
+
+private:
+    std::vector<size_t> cell_of, fill;
+};
+
+// Fill accNext of every active particle with the short-range pair force
+// from its neighbours, using minimum-image separations across the periodic
+// boundaries. Each particle sums over its full 3x3 stencil, so no two
+// threads write the same particle and the result does not depend on the
+// thread count. Returns the total potential energy.
+template <typename Container>
+double computeForces(Container& particles, const force_params& params, cell_list& cells, thread_pool& pool) {
+    double range = params.range();
+    double range2 = range * range;
+    cells.build(particles, range);
+
+    size_t ncells = static_cast<size_t>(cells.ncell) * cells.ncell;
+    std::vector<double> energy(pool.size(), 0.0);
+    pool.parallel_for(ncells, [&](size_t t, size_t begin, size_t end) {
+        double localEnergy = 0.0;
+        for (size_t c = begin; c < end; ++c) {
+            int cx = static_cast<int>(c % cells.ncell);
+            int cy = static_cast<int>(c / cells.ncell);
+            for (size_t i = cells.cell_start[c]; i < cells.cell_start[c + 1]; ++i) {
+                double xi = cells.x[i], yi = cells.y[i];
+                double fx = 0.0, fy = 0.0;
+                cells.forEachNeighbour(cx, cy, i, [&](size_t j) {
+                    double dx = minimumImage(xi - cells.x[j]);
+                    double dy = minimumImage(yi - cells.y[j]);
+                    double r2 = dx * dx + dy * dy;
+                    if (r2 >= range2) return;
+                    double e;
+                    double f = pairForce(params, r2, e);
+                    fx += f * dx;
+                    fy += f * dy;
+                    localEnergy += 0.5 * e; // Each pair is visited from both ends
+                });
+                Particle& p = particles[cells.order[i]];
+                p.accNext[0] = fx;
+                p.accNext[1] = fy;
+            }
+        }
+        energy[t] = localEnergy;
+    });
+
+    double total = 0.0;
+    for (double e : energy) total += e;
+    return total;
+}
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+#include <cstddef> //needed for size_t
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <stdexcept>
+#include <type_traits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include "particle.h"
+#include "file_io.h"
+
+// Checkpoint file:
+//   checkpoint_header (64 bytes)
+//   rngBytes of particle_rng state in its standard text form
+//   count raw Particle records, every field and flag as held in memory
+// Particle records are only portable between builds with the same layout,
+// so the header records sizeof(Particle) and restore refuses anything else.
+// Bump checkpointVersion whenever Particle or the header changes.
+// Version 2: Particle gained id, and mode took the reserved word (0 in
+// version 2 files written before that). Restore refuses every other version,
+// version 1 included.
+const uint32_t checkpointVersion = 2;
+
+struct checkpoint_header {
+    char magic[8] = {'P', 'C', 'K', 'P', 'T', 0, 0, 0};
+    uint32_t version = checkpointVersion;
+    uint32_t particleBytes = sizeof(Particle);
+    uint64_t count = 0;         // Particle records, inactive ones included
+    uint64_t step = 0;          // Next iteration to run
+    int64_t eraseInterval = 1;  // N of the sims that erase periodically
+    uint64_t rngBytes = 0;
+    uint64_t seed = 0;          // Key of the counter-based generator, see philox.h
+    uint64_t mode = 0;          // Sim-specific run mode a restart must keep
+};
+static_assert(sizeof(checkpoint_header) == 64, "checkpoint_header must stay 64 bytes");
+static_assert(std::is_trivially_copyable_v<Particle>, "Particle is written as raw bytes");
+
+// Everything besides the particles that a restarted run needs to carry on
+// exactly where the checkpoint was taken
+struct checkpoint_state {
+    uint64_t step = 0;
+    int64_t eraseInterval = 1;
+    uint64_t seed = 0;
+    uint64_t mode = 0;
+    particle_rng rng;
+};
+
+// Write particles and state to path atomically: everything goes to
+// path.tmp, which is synced and renamed over path, so a crash at any point
+// leaves either the old checkpoint or the new one, never a torn file.
+template <typename Container>
+void writeCheckpoint(const std::string& path, const Container& particles, const checkpoint_state& state) {
+    std::ostringstream rngText;
+    rngText << state.rng;
+    std::string rng = rngText.str();
+
+    checkpoint_header header;
+    header.count = particles.size();
+    header.step = state.step;
+    header.eraseInterval = state.eraseInterval;
+    header.rngBytes = rng.size();
+    header.seed = state.seed;
+    header.mode = state.mode;
+
+    // Contiguous containers are written straight from their storage
+    std::vector<Particle> gathered;
+    const Particle* records;
+    if constexpr (requires { particles.data(); }) {
+        records = particles.data();
+    } else {
+        gathered.reserve(particles.size());
+        for (const auto& p : particles) gathered.push_back(p);
+        records = gathered.data();
+    }
+
+    std::string temporary = path + ".tmp";
+    int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) throw std::runtime_error("writeCheckpoint: cannot open " + temporary + ": " + std::strerror(errno));
+    try {
+        iovec parts[3] = {{&header, sizeof(header)},
+                          {rng.data(), rng.size()},
+                          {const_cast<Particle*>(records), header.count * sizeof(Particle)}};
+        writeAllv(fd, parts, 3, "writeCheckpoint");
+        if (::fsync(fd) != 0) throw std::runtime_error(std::string("writeCheckpoint: fsync failed: ") + std::strerror(errno));
+    } catch (...) {
+        ::close(fd);
+        ::unlink(temporary.c_str());
+        throw;
+    }
+    if (::close(fd) != 0 || ::rename(temporary.c_str(), path.c_str()) != 0) {
+        int error = errno;
+        ::unlink(temporary.c_str());
+        throw std::runtime_error("writeCheckpoint: cannot replace " + path + ": " + std::strerror(error));
+    }
+
+    // Make the rename itself durable
+    size_t slash = path.find_last_of('/');
+    std::string directory = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+    int dirfd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dirfd >= 0) {
+        ::fsync(dirfd);
+        ::close(dirfd);
+    }
+}
+
+// Replace the contents of particles and state with the checkpoint at path.
+// Contiguous containers are resized once and filled with a single read, so
+// storage reserved beforehand is used as it is.
+template <typename Container>
+void readCheckpoint(const std::string& path, Container& particles, checkpoint_state& state) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("readCheckpoint: cannot open " + path + ": " + std::strerror(errno));
+    try {
+        checkpoint_header header;
+        readAll(fd, &header, sizeof(header), "readCheckpoint");
+        if (std::memcmp(header.magic, checkpoint_header().magic, sizeof(header.magic)) != 0) {
+            throw std::runtime_error("readCheckpoint: " + path + " is not a checkpoint");
+        }
+        if (header.version != checkpointVersion) {
+            throw std::runtime_error("readCheckpoint: " + path + " is version " + std::to_string(header.version) +
+                                     ", expected " + std::to_string(checkpointVersion));
+        }
+        if (header.particleBytes != sizeof(Particle)) {
+            throw std::runtime_error("readCheckpoint: " + path + " was written with a different Particle layout");
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0 ||
+            static_cast<uint64_t>(st.st_size) != sizeof(header) + header.rngBytes + header.count * sizeof(Particle)) {
+            throw std::runtime_error("readCheckpoint: " + path + " has the wrong size");
+        }
+
+        std::string rng(header.rngBytes, '\0');
+        readAll(fd, rng.data(), rng.size(), "readCheckpoint");
+        std::istringstream rngText(rng);
+        rngText >> state.rng;
+        if (!rngText) throw std::runtime_error("readCheckpoint: " + path + " has a corrupt RNG state");
+        state.step = header.step;
+        state.eraseInterval = header.eraseInterval;
+        state.seed = header.seed;
+        state.mode = header.mode;
+
+        size_t count = static_cast<size_t>(header.count);
+        if constexpr (requires { particles.data(); particles.resize(count); }) {
+            particles.resize(count);
+            readAll(fd, particles.data(), count * sizeof(Particle), "readCheckpoint");
+        } else {
+            std::vector<Particle> records(count);
+            readAll(fd, records.data(), count * sizeof(Particle), "readCheckpoint");
+            particles.clear();
+            for (const auto& p : records) particles.push_back(p);
+        }
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+    ::close(fd);
+}
+
+#endif
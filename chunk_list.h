@@ -4,18 +4,59 @@
 #include <iostream>
 #include <iterator>
 #include <functional>
+#include <utility>
+#include <vector>
+#include <cstdlib>
+#include <new>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+// Controls how big each new chunk of a chunk_list is.
+// A new chunk grows the list's total capacity by (growth - 1), clamped to
+// [initial, max], so a list with max == initial has fixed size chunks and a
+// list with max > initial grows geometrically as it fills up.
+struct chunk_policy
+{
+    size_t initial = 100;    // Size of the first chunk
+    size_t max = 100;        // Largest chunk
+    double growth = 2.0;     // Capacity growth factor per new chunk
+    bool huge_pages = false; // Ask for transparent huge pages on big chunks
+
+    static chunk_policy fixed(size_t size)
+    {
+        chunk_policy p;
+        p.initial = p.max = size ? size : 1;
+        return p;
+    }
+    static chunk_policy adaptive(size_t initial, size_t max, double growth = 2.0)
+    {
+        chunk_policy p;
+        p.initial = initial ? initial : 1;
+        p.max = max < p.initial ? p.initial : max;
+        p.growth = growth;
+        return p;
+    }
+};
+
 template <typename T>
 class chunk_list
 {
     // Individual linked list element
     // You can put classes inside classes
     // Access as chunk_list::element (but it is private, so you can't!)
+    struct chunk;
     struct element
     {
         // Store the templated datatype
         T data;
         element *prev = nullptr;
+        // next doubles as the free slot link while the element is unused
         element *next = nullptr;
+        // Chunk this element's storage belongs to
+        chunk *owner = nullptr;
+        // Set while the slot holds a list element
+        bool in_use = false;
         // constructor, copy item in
         element(const T &in) : data(in) {}
         element() {}
@@ -23,21 +64,63 @@ class chunk_list
     struct chunk
     {
         element *elements = nullptr;
-        int count = 0, used = 0;
+        // count is the capacity, used the high-water mark and live the
+        // number of slots currently holding list elements
+        int count = 0, used = 0, live = 0;
+        // Erased slots waiting to be reused
+        element *free_slots = nullptr;
         chunk *next = nullptr;
         chunk *prev = nullptr;
+        // Links in the list of chunks that still have room
+        chunk *next_free = nullptr;
+        chunk *prev_free = nullptr;
+        bool in_free_list = false;
         //constructor, allocate element based on count parameter
-        chunk(size_t count)
+        //Storage is cache line aligned, and huge page aligned and advised
+        //when huge_pages is set and the chunk is at least one huge page
+        chunk(size_t count, bool huge_pages = false)
         {
-            elements = new element[count];
+            const size_t huge_page = 2 * 1024 * 1024;
+            size_t bytes = count * sizeof(element);
+            size_t align = 64;
+            if (huge_pages && bytes >= huge_page)
+                align = huge_page;
+            bytes = (bytes + align - 1) & ~(align - 1);
+            void *storage = std::aligned_alloc(align < alignof(element) ? alignof(element) : align, bytes);
+            if (!storage)
+                throw std::bad_alloc();
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+            if (align == huge_page)
+                madvise(storage, bytes, MADV_HUGEPAGE);
+#endif
+            elements = static_cast<element *>(storage);
             this->count = count;
+            for (size_t i = 0; i < count; i++)
+            {
+                new (&elements[i]) element();
+                elements[i].owner = this;
+            }
+        }
+        bool has_space() const { return free_slots || used < count; }
+        // Forget all contents so the chunk can be handed out again
+        void reset()
+        {
+            used = 0;
+            live = 0;
+            free_slots = nullptr;
+            next = prev = next_free = prev_free = nullptr;
+            in_free_list = false;
         }
         // Destructor - clear the list when the object is destroyed
         ~chunk()
         {
             if (!elements)
                 return;
-            delete[] elements;
+            for (int i = 0; i < count; i++)
+            {
+                elements[i].~element();
+            }
+            std::free(elements);
         }
     };
     // Make iterator compatible with stl iterators
@@ -74,91 +157,249 @@ class chunk_list
     size_t elements = 0;
     element *head = nullptr, *tail = nullptr;
     chunk *head_chunk = nullptr, *tail_chunk = nullptr;
+    // Chunks with free slots, most recently freed first
+    chunk *free_chunks = nullptr;
+    // One emptied chunk kept back so a list that hovers around a chunk
+    // boundary does not allocate and free a chunk every step
+    chunk *spare_chunk = nullptr;
+    size_t nchunks = 0;
+    // Total number of slots over all linked chunks
+    size_t nslots = 0;
+    // Incremental compaction state: the next chunk to examine and the chunk
+    // evacuated elements are moved into
+    chunk *compact_cursor = nullptr, *compact_target = nullptr;
+    chunk_policy policy;
+
+    // Size of the next chunk under the current policy
+    size_t next_chunk_size()
+    {
+        double grow = nslots * (policy.growth - 1.0);
+        if (grow < policy.initial)
+            return policy.initial;
+        if (grow > policy.max)
+            return policy.max;
+        return static_cast<size_t>(grow);
+    }
+
+    void link_free(chunk *c)
+    {
+        c->prev_free = nullptr;
+        c->next_free = free_chunks;
+        if (free_chunks)
+            free_chunks->prev_free = c;
+        free_chunks = c;
+        c->in_free_list = true;
+    }
+
+    void unlink_free(chunk *c)
+    {
+        if (c->prev_free)
+            c->prev_free->next_free = c->next_free;
+        else
+            free_chunks = c->next_free;
+        if (c->next_free)
+            c->next_free->prev_free = c->prev_free;
+        c->next_free = c->prev_free = nullptr;
+        c->in_free_list = false;
+    }
+
+    // Unlink an empty chunk and keep it as the spare or free it
+    void release_chunk(chunk *c)
+    {
+        if (c->in_free_list)
+            unlink_free(c);
+        if (c->prev)
+            c->prev->next = c->next;
+        else
+            head_chunk = c->next;
+        if (c->next)
+            c->next->prev = c->prev;
+        else
+            tail_chunk = c->prev;
+        if (compact_cursor == c)
+            compact_cursor = c->next;
+        if (compact_target == c)
+            compact_target = nullptr;
+        nchunks--;
+        nslots -= c->count;
+        if (!spare_chunk)
+        {
+            c->reset();
+            spare_chunk = c;
+        }
+        else
+        {
+            delete c;
+        }
+    }
+
+    // Return an element's slot to its chunk, releasing the chunk if that
+    // was its last live element
+    void release_element(element *e)
+    {
+        chunk *c = e->owner;
+        e->in_use = false;
+        e->prev = nullptr;
+        e->next = c->free_slots;
+        c->free_slots = e;
+        c->live--;
+        if (c->live == 0)
+        {
+            release_chunk(c);
+        }
+        else if (!c->in_free_list)
+        {
+            link_free(c);
+        }
+    }
+
+    // Take a free slot from chunk c, which must have space
+    element *take_slot(chunk *c)
+    {
+        element *slot;
+        if (c->free_slots)
+        {
+            slot = c->free_slots;
+            c->free_slots = slot->next;
+        }
+        else
+        {
+            slot = &c->elements[c->used];
+            c->used++;
+        }
+        slot->in_use = true;
+        slot->prev = nullptr;
+        slot->next = nullptr;
+        c->live++;
+        if (!c->has_space())
+        {
+            unlink_free(c);
+        }
+        return slot;
+    }
+
+    // Move every element out of chunk c into the compaction target and
+    // release c. Only iterators to elements in c are invalidated.
+    void evacuate(chunk *c)
+    {
+        // Keep c from being picked as a destination while it is emptied
+        if (c->in_free_list)
+            unlink_free(c);
+        for (int i = 0; i < c->used; i++)
+        {
+            element *src = &c->elements[i];
+            if (!src->in_use)
+                continue;
+            if (!compact_target || !compact_target->has_space())
+            {
+                add_chunk();
+                compact_target = tail_chunk;
+            }
+            element *dst = take_slot(compact_target);
+            dst->data = std::move(src->data);
+            dst->prev = src->prev;
+            dst->next = src->next;
+            if (src->prev)
+                src->prev->next = dst;
+            else
+                head = dst;
+            if (src->next)
+                src->next->prev = dst;
+            else
+                tail = dst;
+            src->in_use = false;
+        }
+        release_chunk(c);
+    }
+
+    //Unhook every chunk and element from the list, leaving it empty, and
+    //return the old chunks so their elements can still be read
+    chunk *detach_chunks()
+    {
+        chunk *old_chunks = head_chunk;
+        head_chunk = tail_chunk = free_chunks = nullptr;
+        compact_cursor = compact_target = nullptr;
+        head = tail = nullptr;
+        elements = 0;
+        nchunks = 0;
+        nslots = 0;
+        return old_chunks;
+    }
+
+    void delete_chunks(chunk *old_chunks)
+    {
+        chunk *next_chunk = nullptr;
+        while (old_chunks)
+        {
+            next_chunk = old_chunks->next;
+            delete old_chunks;
+            old_chunks = next_chunk;
+        }
+    }
 
 public:
+    chunk_list() {}
+    // Fixed chunk size
+    explicit chunk_list(size_t chunk_size) : policy(chunk_policy::fixed(chunk_size)) {}
+    explicit chunk_list(const chunk_policy &p) : policy(p) {}
+    chunk_list(const chunk_list &) = delete;
+    chunk_list &operator=(const chunk_list &) = delete;
 
     //Pack the chunks and relink the elements
+    //The elements are copied in list order into a fresh set of chunks, so
+    //the result is dense and memory order matches list order again
     void pack_chunks()
     {
         if (!head_chunk)
             return;
-        chunk *current = head_chunk;
-        element *current_element = head, *prev_element=nullptr, *next_element=nullptr;
-        while (current)
-        {
-            current->used = 0;
-            current = current->next;
-        }
-        current = head_chunk;
+        element *current_element = head, *next_element = nullptr;
+        chunk *old_chunks = detach_chunks();
         while (current_element)
         {
-            if (current->used == current->count)
-            {
-                current = current->next;
-            }
             next_element = current_element->next;
-            current->elements[current->used] = *current_element;
-            current->elements[current->used].prev=nullptr;
-            current->elements[current->used].next=nullptr;
-            current->used++;
+            push_back(current_element->data);
             current_element = next_element;
         }
-        //Delete all unused chunks
-        current = head_chunk;
-        chunk *next_chunk = nullptr;
-        while (current)
-        {
-            next_chunk = current->next;
-            if (current->used == 0)
-            {
-                if (current->prev)
-                {
-                    current->prev->next = current->next;
-                }
-                else
-                {
-                    head_chunk = current->next;
-                }
-                if (current->next)
-                {
-                    current->next->prev = current->prev;
-                }
-                else
-                {
-                    tail_chunk = current->prev;
-                }
-                delete current;
-            }
-            current = next_chunk;
-        }
-        //Now relink the elements
-        head = &head_chunk->elements[0];
-        head->prev=nullptr;
-        current = head_chunk;
-        size_t npart=1;
-        prev_element = nullptr;
-        int u=0;
-        while(current)
-        {
-            for (u=0; u<current->used; u++)
-            {
-                current_element = &current->elements[u];
-                current_element->prev = prev_element;
-                if (prev_element)
-                {
-                    prev_element->next = current_element;
-                }
-                prev_element = current_element;
-            }
-            current = current->next;
-        }
-        tail = prev_element;       
+        delete_chunks(old_chunks);
+    }
+
+    //Pack the chunks in a new order: order[k] is the current list position
+    //of the element that becomes the k-th. Positions left out are dropped.
+    void pack_chunks(const std::vector<size_t> &order)
+    {
+        if (!head_chunk)
+            return;
+        std::vector<element *> old_elements;
+        old_elements.reserve(elements);
+        for (element *e = head; e; e = e->next)
+            old_elements.push_back(e);
+        chunk *old_chunks = detach_chunks();
+        for (size_t k : order)
+            push_back(old_elements[k]->data);
+        delete_chunks(old_chunks);
     }
 
     //Add chunk
     void add_chunk()
     {
-        chunk *new_chunk = new chunk(100);
+        chunk *new_chunk;
+        size_t size = next_chunk_size();
+        // The spare is only reused if it is at least as big as the policy
+        // asks for, otherwise a growing list would get stuck on small chunks
+        if (spare_chunk && static_cast<size_t>(spare_chunk->count) >= size)
+        {
+            new_chunk = spare_chunk;
+            spare_chunk = nullptr;
+        }
+        else
+        {
+            delete spare_chunk;
+            spare_chunk = nullptr;
+            new_chunk = new chunk(size, policy.huge_pages);
+        }
+        nchunks++;
+        nslots += new_chunk->count;
+        link_free(new_chunk);
         if (!head_chunk)
         {
             head_chunk = new_chunk;
@@ -171,21 +412,54 @@ public:
     }
 
     // Create a new element
+    // Reuses an erased slot if any chunk has one, otherwise takes the next
+    // untouched slot, adding a chunk when all are full
     element *create_element(const T &in)
     {
-        if(!head_chunk)
-        {
-            add_chunk();
-        }
-        if (tail_chunk->used == tail_chunk->count)
+        if (!free_chunks)
         {
             add_chunk();
         }
-        element *new_element = &tail_chunk->elements[tail_chunk->used];
+        element *new_element = take_slot(free_chunks);
         new_element->data = in;
-        tail_chunk->used++;
         return new_element;
     }
+
+    // Fraction of the slots in linked chunks that hold no element
+    double fragmentation()
+    {
+        if (nslots == 0)
+            return 0.0;
+        return 1.0 - static_cast<double>(elements) / nslots;
+    }
+
+    // Incremental alternative to pack_chunks.
+    // Does nothing unless fragmentation() is at least threshold. Otherwise it
+    // examines up to max_chunks chunks, continuing round the chunk list from
+    // where the last call stopped, and evacuates each one that is less than
+    // (1 - threshold) full. The work per call is bounded by max_chunks chunk
+    // sizes. Iterators to elements outside the evacuated chunks stay valid.
+    // Returns the number of chunks released.
+    size_t compact_chunks(size_t max_chunks, double threshold = 0.25)
+    {
+        if (fragmentation() < threshold)
+            return 0;
+        size_t evacuated = 0;
+        for (size_t examined = 0; examined < max_chunks && head_chunk; examined++)
+        {
+            if (!compact_cursor)
+                compact_cursor = head_chunk;
+            chunk *c = compact_cursor;
+            compact_cursor = c->next;
+            if (c == compact_target)
+                continue;
+            if (c->live >= c->count * (1.0 - threshold))
+                continue;
+            evacuate(c);
+            evacuated++;
+        }
+        return evacuated;
+    }
     // Add at end
     void push_back(const T &in)
     {
@@ -194,6 +468,7 @@ public:
         {
             head = create_element(in);
             tail = head;
+            elements++;
             return;
         }
         // Create the new item
@@ -211,6 +486,7 @@ public:
         {
             head = create_element(in);
             tail = head;
+            elements++;
             return;
         }
         head->prev = create_element(in);
@@ -219,6 +495,12 @@ public:
         elements++;
     }
     size_t size() { return elements; }
+    // Number of chunks currently linked into the list
+    size_t chunks() { return nchunks; }
+    // Number of slots in all linked chunks
+    size_t capacity() { return nslots; }
+    // Change the size policy for chunks added from now on
+    void set_policy(const chunk_policy &p) { policy = p; }
 
 		size_t count(){element* current=head;
 			size_t ct=0; while (current){ct++;current=current->next;}
@@ -267,30 +549,40 @@ public:
     iterator insert(iterator position, otherit first, otherit last)
     {
         element *current, *orig_next;
-        if (position.current == nullptr)
+        // Insert between current and orig_next
+        orig_next = position.current;
+        if (orig_next == nullptr)
         {
             current = tail;
         }
         else
         {
-            current = position.current->prev;
+            current = orig_next->prev;
         }
 
-        orig_next = current->next;
         otherit it;
-        int add = 0;
         for (it = first; it != last; ++it)
         {
-            current->next = create_element(*it);
-            current->next->prev = current;
-            current = current->next;
+            element *new_element = create_element(*it);
+            new_element->prev = current;
+            if (current)
+            {
+                current->next = new_element;
+            }
+            else
+            {
+                head = new_element;
+            }
+            current = new_element;
             elements++;
-            add++;
+        }
+        if (current)
+        {
+            current->next = orig_next;
         }
         if (orig_next)
         {
             orig_next->prev = current;
-            current->next = orig_next;
         }
         else
         {
@@ -326,43 +618,56 @@ public:
 					delete current;
 					current=next;
 				}
-        
+        delete spare_chunk;
+        spare_chunk = nullptr;
+        head_chunk = tail_chunk = free_chunks = nullptr;
+        compact_cursor = compact_target = nullptr;
+        head = tail = nullptr;
+        elements = 0;
+        nchunks = 0;
+        nslots = 0;
     }
 
+    // Unlink the element and give its slot back to its chunk for reuse
     iterator erase(iterator pos)
     {
-        bool is_head = (pos.current->prev == nullptr);
-        bool is_tail = (pos.current->next == nullptr);
-        // Yes, this is horrible
-        // If this isn't the first element then we have to
-        // Get the previous and set the next pointer to
-        // the current item's next
-        if (!is_head)
+        element *e = pos.current;
+        if (e->prev)
         {
-            pos.current->prev->next = pos.current->next;
+            e->prev->next = e->next;
         }
         else
         {
-            this->head = pos.current->next;
-            pos.current->next->prev = nullptr;
+            this->head = e->next;
         }
-        // If this isn't the last element then we have to
-        // Get the next and set the prev pointer to
-        // the current item's prev
-        if (!is_tail)
+        if (e->next)
         {
-            pos.current->next->prev = pos.current->prev;
+            e->next->prev = e->prev;
         }
         else
         {
-            this->tail = pos.current->prev;
-            pos.current->prev->next = nullptr;
+            this->tail = e->prev;
         }
-        iterator i(pos.current->next, tail);
+        iterator i(e->next, tail);
+        release_element(e);
         elements--;
         return i;
     }
 
+    // Unordered removal: the last element's data is moved into pos and the
+    // last element is erased. Returns pos, which now holds the moved data
+    // (or end() if pos was the last element).
+    iterator swap_remove(iterator pos)
+    {
+        if (pos.current == tail)
+        {
+            return erase(pos);
+        }
+        pos.current->data = std::move(tail->data);
+        erase(iterator(tail, tail));
+        return iterator(pos.current, tail);
+    }
+
     iterator erase(iterator start, iterator end)
     {
         iterator current;
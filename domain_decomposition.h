@@ -0,0 +1,169 @@
+#ifndef DOMAIN_DECOMPOSITION_H
+#define DOMAIN_DECOMPOSITION_H
+#include <cstddef> //needed for size_t
+#include <cmath>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include "particle.h"
+#include "thread_pool.h"
+#include "cell_list.h"
+
+// One rectangle of the unit box with the particles it owns
+struct subdomain {
+    double x0, x1, y0, y1;                       // Bounds, [x0, x1) x [y0, y1)
+    std::vector<size_t> neighbours;              // Distinct adjacent domains, not including this one
+    std::vector<Particle> particles;             // Owned particles
+    std::vector<std::vector<Particle>> outgoing; // Particles leaving, by destination domain
+    std::vector<std::vector<Particle>> halo;     // Copies near each neighbour, by destination domain
+    size_t owned = 0;                            // Owned particles while halo copies are appended
+    cell_list cells;
+    thread_pool serial{1};                       // computeForces() runs inline on the domain's worker
+};
+
+// Split of the periodic unit box into an nx by ny grid of subdomains.
+// Every subdomain has its own container and is stepped by its own worker
+// thread. A step has three phases, with a barrier between each:
+//   1. drift the owned particles; those that left go into the outgoing
+//      buffer for the domain they entered
+//   2. take in the particles other domains sent here, then copy the owned
+//      particles within the force range of each neighbour into its halo
+//      buffer
+//   3. append the neighbours' halo copies, compute forces over owned + halo,
+//      drop the copies and kick the owned particles
+// Buffers are only read by their destination after the barrier, so no
+// locks are needed. Subdomains must be at least the force range wide, so
+// only adjacent domains exchange halos.
+class domain_decomposition {
+public:
+    domain_decomposition(int nx, int ny) : nx(nx), ny(ny), pool(static_cast<size_t>(nx) * ny) {
+        size_t count = static_cast<size_t>(nx) * ny;
+        for (size_t d = 0; d < count; ++d) {
+            auto domain = std::make_unique<subdomain>();
+            int cx = static_cast<int>(d % nx), cy = static_cast<int>(d / nx);
+            domain->x0 = static_cast<double>(cx) / nx;
+            domain->x1 = static_cast<double>(cx + 1) / nx;
+            domain->y0 = static_cast<double>(cy) / ny;
+            domain->y1 = static_cast<double>(cy + 1) / ny;
+            for (int dy = -1; dy <= 1; ++dy) {
+                for (int dx = -1; dx <= 1; ++dx) {
+                    size_t n = static_cast<size_t>((cy + dy + ny) % ny) * nx + (cx + dx + nx) % nx;
+                    if (n == d) continue;
+                    if (std::find(domain->neighbours.begin(), domain->neighbours.end(), n) == domain->neighbours.end()) {
+                        domain->neighbours.push_back(n);
+                    }
+                }
+            }
+            domain->outgoing.resize(count);
+            domain->halo.resize(count);
+            domains.push_back(std::move(domain));
+        }
+    }
+
+    size_t size() const { return domains.size(); }
+    subdomain& operator[](size_t d) { return *domains[d]; }
+
+    // Smallest subdomain side, which the force range must not exceed
+    double minWidth() const { return std::min(1.0 / nx, 1.0 / ny); }
+
+    size_t domainOf(double x, double y) const {
+        int cx = std::clamp(static_cast<int>(x * nx), 0, nx - 1);
+        int cy = std::clamp(static_cast<int>(y * ny), 0, ny - 1);
+        return static_cast<size_t>(cy) * nx + cx;
+    }
+
+    // Hand every active particle to the domain that contains it
+    template <typename Container>
+    void distribute(const Container& particles) {
+        for (auto& domain : domains) domain->particles.clear();
+        for (const auto& p : particles) {
+            if (p.active != Active) continue;
+            domains[domainOf(p.position[0], p.position[1])]->particles.push_back(p);
+        }
+    }
+
+    // Copy the owned particles of every domain into one container
+    template <typename Container>
+    void gather(Container& particles) const {
+        particles.clear();
+        for (const auto& domain : domains) {
+            for (const auto& p : domain->particles) particles.push_back(p);
+        }
+    }
+
+    // Velocity-Verlet step with short-range forces. Returns the number of
+    // particles that changed domain.
+    size_t step(double dt, const force_params& params) {
+        std::vector<size_t> migrated(domains.size(), 0);
+
+        // 1. Drift and sort out the leavers
+        pool.run([&](size_t d) {
+            subdomain& domain = *domains[d];
+            for (auto& out : domain.outgoing) out.clear();
+            auto& own = domain.particles;
+            size_t kept = 0;
+            for (size_t i = 0; i < own.size(); ++i) {
+                driftParticle(own[i], dt);
+                size_t to = domainOf(own[i].position[0], own[i].position[1]);
+                if (to != d) {
+                    domain.outgoing[to].push_back(own[i]);
+                    migrated[d]++;
+                } else {
+                    own[kept++] = own[i];
+                }
+            }
+            own.resize(kept);
+        });
+
+        // 2. Take in arrivals and fill the halo buffers
+        double range = params.range();
+        pool.run([&](size_t d) {
+            subdomain& domain = *domains[d];
+            for (const auto& source : domains) {
+                const auto& in = source->outgoing[d];
+                domain.particles.insert(domain.particles.end(), in.begin(), in.end());
+            }
+            for (size_t n : domain.neighbours) {
+                const subdomain& neighbour = *domains[n];
+                auto& out = domain.halo[n];
+                out.clear();
+                for (const auto& p : domain.particles) {
+                    double gx = gap(p.position[0], neighbour.x0, neighbour.x1);
+                    double gy = gap(p.position[1], neighbour.y0, neighbour.y1);
+                    if (gx * gx + gy * gy < range * range) out.push_back(p);
+                }
+            }
+        });
+
+        // 3. Forces over owned + halo, then kick
+        pool.run([&](size_t d) {
+            subdomain& domain = *domains[d];
+            auto& own = domain.particles;
+            domain.owned = own.size();
+            for (size_t n : domain.neighbours) {
+                const auto& in = domains[n]->halo[d];
+                own.insert(own.end(), in.begin(), in.end());
+            }
+            computeForces(own, params, domain.cells, domain.serial);
+            own.resize(domain.owned);
+            for (auto& p : own) kickParticle(p, dt);
+        });
+
+        size_t total = 0;
+        for (size_t m : migrated) total += m;
+        return total;
+    }
+
+private:
+    int nx, ny;
+    std::vector<std::unique_ptr<subdomain>> domains;
+    thread_pool pool; // One worker per domain
+
+    // Periodic distance from coordinate v to the interval [lo, hi)
+    static double gap(double v, double lo, double hi) {
+        if (v >= lo && v < hi) return 0.0;
+        return std::min(std::fabs(minimumImage(v - lo)), std::fabs(minimumImage(v - hi)));
+    }
+};
+
+#endif
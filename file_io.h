@@ -0,0 +1,54 @@
+#ifndef FILE_IO_H
+#define FILE_IO_H
+#include <cstddef> //needed for size_t
+#include <cstring>
+#include <cerrno>
+#include <climits>
+#include <string>
+#include <stdexcept>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+// writev() until everything is out, picking up after partial writes and
+// passing at most IOV_MAX parts per call, so count is not limited.
+// Throws std::runtime_error with who in the message on failure.
+inline void writeAllv(int fd, iovec* parts, int count, const char* who) {
+    while (count > 0) {
+        ssize_t written = ::writev(fd, parts, count < IOV_MAX ? count : IOV_MAX);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error(std::string(who) + ": write failed: " + std::strerror(errno));
+        }
+        size_t left = static_cast<size_t>(written);
+        while (count > 0 && left >= parts->iov_len) {
+            left -= parts->iov_len;
+            ++parts;
+            --count;
+        }
+        if (count > 0) {
+            parts->iov_base = static_cast<char*>(parts->iov_base) + left;
+            parts->iov_len -= left;
+        }
+    }
+}
+
+// read() exactly bytes, failing on errors and on a short file
+inline void readAll(int fd, void* data, size_t bytes, const char* who) {
+    char* out = static_cast<char*>(data);
+    while (bytes > 0) {
+        ssize_t got = ::read(fd, out, bytes);
+        if (got < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error(std::string(who) + ": read failed: " + std::strerror(errno));
+        }
+        if (got == 0) throw std::runtime_error(std::string(who) + ": file is truncated");
+        out += got;
+        bytes -= static_cast<size_t>(got);
+    }
+}
+
+#endif
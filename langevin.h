@@ -0,0 +1,154 @@
+#ifndef LANGEVIN_H
+#define LANGEVIN_H
+#include <cstddef> //needed for size_t
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include "particle.h"
+#include "philox.h"
+
+// Langevin dynamics at temperature kT with friction gamma (unit mass),
+// integrated with the BAOAB splitting of Leimkuhler and Matthews:
+//   B  v += a dt/2        A  x += v dt/2
+//   O  v = c1 v + c2 sqrt(kT) g,  c1 = exp(-gamma dt), c2 = sqrt(1 - c1^2)
+//   A  x += v dt/2        (forces at the new positions)
+//   B  v += a' dt/2
+// The first four run in langevinDrift() where the sims call driftParticle()
+// and the last in langevinKick() in place of kickParticle(). O is exact for
+// any gamma dt, and gamma = 0 gives velocity Verlet back.
+struct langevin_params {
+    double gamma = 1.0;
+    double kT = 1e-3;
+    uint64_t seed = 1691169547;
+};
+
+// log(u) for u in (0, 1] without calls or branches, so a loop over it
+// vectorises: u = m 2^e with m in [sqrt(1/2), sqrt(2)), and
+// log(m) = 2 atanh(s) with s = (m - 1) / (m + 1), |s| < 0.172, from the
+// odd series to s^15 (relative error below 1e-13)
+inline double noiseLog(double u) {
+    uint64_t bits;
+    std::memcpy(&bits, &u, sizeof(bits));
+    double e = static_cast<double>(static_cast<int32_t>(bits >> 52) - 1023);
+    bits = (bits & 0x000FFFFFFFFFFFFFull) | 0x3FF0000000000000ull; // m in [1, 2)
+    double m;
+    std::memcpy(&m, &bits, sizeof(m));
+    bool high = m > 1.4142135623730951;
+    m = high ? 0.5 * m : m;
+    e = high ? e + 1.0 : e;
+    double s = (m - 1.0) / (m + 1.0);
+    double s2 = s * s;
+    double series = 1.0 + s2 * (1.0 / 3 + s2 * (1.0 / 5 + s2 * (1.0 / 7 + s2 * (1.0 / 9 + s2 * (1.0 / 11 + s2 * (1.0 / 13 + s2 * (1.0 / 15)))))));
+    return 2.0 * s * series + e * 0.6931471805599453;
+}
+
+// sqrt(x) for x >= 0 without a call: std::sqrt keeps a branch to set
+// errno for negative x, which stops the loop vectorising. A bit-trick
+// guess at 1/sqrt(x) good to 5 bits and four Newton steps give full
+// precision; x = 0 is selected separately.
+inline double noiseSqrt(double x) {
+    uint64_t bits;
+    std::memcpy(&bits, &x, sizeof(bits));
+    bits = 0x5FE6EB50C7B537A9ull - (bits >> 1);
+    double y;
+    std::memcpy(&y, &bits, sizeof(y));
+    double half = 0.5 * x;
+    y = y * (1.5 - half * y * y);
+    y = y * (1.5 - half * y * y);
+    y = y * (1.5 - half * y * y);
+    y = y * (1.5 - half * y * y);
+    return x > 0.0 ? x * y : 0.0;
+}
+
+// cos and sin of 2 pi u for u in [0, 1), branch-free. 2 pi u is split into
+// a quarter turn q pi/2, pi/4 and phi in [-pi/4, pi/4); cos and sin of phi
+// come from their Taylor series, which are exact to double precision there,
+// then the result is rotated by pi/4 and q quarter turns
+inline void noiseSinCos(double u, double& c, double& s) {
+    double quarters = 4.0 * u;
+    int32_t quarter = static_cast<int32_t>(quarters); // quarters >= 0, so truncation is floor
+    double q = static_cast<double>(quarter);
+    double phi = (quarters - q - 0.5) * 1.5707963267948966;
+    double p2 = phi * phi;
+    double cp = 1.0 + p2 * (-1.0 / 2 + p2 * (1.0 / 24 + p2 * (-1.0 / 720 + p2 * (1.0 / 40320 + p2 * (-1.0 / 3628800 +
+                p2 * (1.0 / 479001600 + p2 * (-1.0 / 87178291200)))))));
+    double sp = phi * (1.0 + p2 * (-1.0 / 6 + p2 * (1.0 / 120 + p2 * (-1.0 / 5040 + p2 * (1.0 / 362880 + p2 * (-1.0 / 39916800 +
+                p2 * (1.0 / 6227020800 + p2 * (-1.0 / 1307674368000))))))));
+    const double r = 0.7071067811865476;
+    double c0 = r * (cp - sp), s0 = r * (cp + sp); // Angle pi/4 + phi
+    // Quarter turns: (c, s) -> (-s, c) for odd q, then negate for q >= 2
+    double odd = static_cast<double>(quarter & 1);
+    double sign = quarter >= 2 ? -1.0 : 1.0;
+    c = sign * (c0 - odd * (s0 + c0));
+    s = sign * (s0 + odd * (c0 - s0));
+}
+
+// Particles per noise batch
+const size_t noiseBatch = 16;
+
+// Two independent standard normal deviates for each of noiseBatch particle
+// ids at step, by Box-Muller from one Philox block per particle. No state
+// is shared, so any thread can draw any particle's noise. Every helper above
+// inlines to straight-line arithmetic, so the compiler vectorises the loop
+// across the batch (Philox, log, sqrt and sin/cos together). The batch size
+// is fixed so there is no scalar remainder loop: every particle's noise
+// comes out of the same instructions, bit for bit, wherever it sits.
+inline void gaussianBatch(uint64_t seed, uint32_t step, const uint32_t* ids, double* g0, double* g1) {
+    for (size_t k = 0; k < noiseBatch; ++k) {
+        philox_block b = philox4x32(ids[k], 0, step, PhiloxNoise, seed);
+        double u0 = 1.0 - philoxUniform(b.w[0], b.w[1]); // (0, 1], so the log is finite
+        double radius = noiseSqrt(-2.0 * noiseLog(u0));
+        double c, s;
+        noiseSinCos(philoxUniform(b.w[2], b.w[3]), c, s);
+        g0[k] = radius * c;
+        g1[k] = radius * s;
+    }
+}
+
+// B, A, O, A of one particle, with its two noise deviates, then the wrap
+inline void langevinDrift(Particle& particle, double dt, double c1, double sigma, double g0, double g1) {
+    particle.wrapX = false;
+    particle.wrapY = false;
+    for (int d = 0; d < 2; ++d) {
+        double v = particle.velocity[d] + 0.5 * dt * particle.acceleration[d];
+        double x = particle.position[d] + 0.5 * dt * v;
+        v = c1 * v + sigma * (d == 0 ? g0 : g1);
+        particle.position[d] = x + 0.5 * dt * v;
+        particle.velocity[d] = v;
+    }
+    wrapParticle(particle);
+}
+
+// Final B with the forces at the new positions, then step the acceleration
+inline void langevinKick(Particle& particle, double dt) {
+    particle.velocity[0] += 0.5 * dt * particle.accNext[0];
+    particle.velocity[1] += 0.5 * dt * particle.accNext[1];
+    particle.acceleration[0] = particle.accNext[0];
+    particle.acceleration[1] = particle.accNext[1];
+}
+
+// langevinDrift() over the active particles in [begin, end) of a
+// random-access container, e.g. one thread's block of a parallel_for.
+// Noise is drawn a batch at a time by particle id, so the trajectory is the
+// same however the particles are split between threads and in whatever
+// order they are stored. A short last batch just draws noise for ids it
+// does not use.
+template <typename Container>
+void langevinDriftRange(Container& particles, size_t begin, size_t end, double dt, uint32_t step, const langevin_params& params) {
+    double c1 = std::exp(-params.gamma * dt);
+    double sigma = std::sqrt((1.0 - c1 * c1) * params.kT);
+    uint32_t ids[noiseBatch] = {};
+    double g0[noiseBatch], g1[noiseBatch];
+    for (size_t first = begin; first < end; first += noiseBatch) {
+        size_t count = std::min(noiseBatch, end - first);
+        for (size_t k = 0; k < count; ++k) ids[k] = particles[first + k].id;
+        gaussianBatch(params.seed, step, ids, g0, g1);
+        for (size_t k = 0; k < count; ++k) {
+            Particle& p = particles[first + k];
+            if (p.active == Active) langevinDrift(p, dt, c1, sigma, g0[k], g1[k]);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,110 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+#include <cstddef> //needed for size_t
+#include <cstdint>
+#include <cmath>
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <iomanip>
+
+// Log-linear histogram of durations in nanoseconds, in the manner of
+// HdrHistogram: every power of two is split into 128 equal sub-buckets, so
+// any recorded value is known to within 1/128 (< 0.8%) from 1 ns up to the
+// full uint64_t range, in a fixed 58 KB of counters. record() is one
+// relaxed atomic increment plus a compare-exchange when a new maximum is
+// seen, so any number of threads can record at once without locks and the
+// histogram can stay on in production runs. Reads are not synchronised
+// with record(); take them once the recorders are done.
+class latency_histogram {
+public:
+    static const int subBits = 7;
+    static const uint64_t subCount = uint64_t(1) << subBits;
+    static const size_t bucketCount = (64 - subBits + 1) * subCount;
+
+    latency_histogram() {
+        for (auto& c : counts) c.store(0, std::memory_order_relaxed);
+    }
+
+    latency_histogram(const latency_histogram&) = delete;
+    latency_histogram& operator=(const latency_histogram&) = delete;
+
+    void record(uint64_t ns) {
+        counts[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(1, std::memory_order_relaxed);
+        uint64_t seen = largest.load(std::memory_order_relaxed);
+        while (ns > seen && !largest.compare_exchange_weak(seen, ns, std::memory_order_relaxed)) {
+        }
+    }
+
+    template <typename Duration>
+    void record(Duration d) {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+        record(static_cast<uint64_t>(ns < 0 ? 0 : ns));
+    }
+
+    uint64_t count() const { return total.load(std::memory_order_relaxed); }
+    uint64_t max() const { return largest.load(std::memory_order_relaxed); }
+
+    // Smallest value v such that at least fraction q of the recorded values
+    // are <= v, to the histogram's precision: the top of the sub-bucket the
+    // q-th value fell into, never more than max()
+    uint64_t percentile(double q) const {
+        uint64_t n = count();
+        if (n == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(std::ceil(q * static_cast<double>(n)));
+        if (rank < 1) rank = 1;
+        if (rank > n) rank = n;
+        uint64_t seen = 0;
+        for (size_t b = 0; b < bucketCount; ++b) {
+            seen += counts[b].load(std::memory_order_relaxed);
+            if (seen >= rank) {
+                uint64_t top = bucketTop(b);
+                return top < max() ? top : max();
+            }
+        }
+        return max();
+    }
+
+    void reset() {
+        for (auto& c : counts) c.store(0, std::memory_order_relaxed);
+        total.store(0, std::memory_order_relaxed);
+        largest.store(0, std::memory_order_relaxed);
+    }
+
+    // One line: count, p50, p90, p99, p99.9 and max in microseconds
+    void report(std::ostream& out, const char* name) const {
+        auto us = [](uint64_t ns) { return static_cast<double>(ns) / 1000.0; };
+        std::ios::fmtflags flags = out.flags();
+        std::streamsize precision = out.precision();
+        out << std::fixed << std::setprecision(1) << name << " latency (us) over " << count() << ":"
+            << " p50 " << us(percentile(0.5)) << " p90 " << us(percentile(0.9)) << " p99 " << us(percentile(0.99))
+            << " p99.9 " << us(percentile(0.999)) << " max " << us(max()) << "\n";
+        out.flags(flags);
+        out.precision(precision);
+    }
+
+private:
+    std::atomic<uint64_t> counts[bucketCount];
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> largest{0};
+
+    // Values below subCount get a bucket each; above that, the position of
+    // the top bit picks the power of two and the next subBits bits the
+    // sub-bucket within it
+    static size_t bucketOf(uint64_t v) {
+        if (v < subCount) return static_cast<size_t>(v);
+        int shift = 63 - __builtin_clzll(v) - subBits; // >= 0
+        return static_cast<size_t>((shift + 1) * subCount + ((v >> shift) - subCount));
+    }
+
+    // Largest value that falls into bucket b
+    static uint64_t bucketTop(size_t b) {
+        if (b < subCount) return b;
+        int shift = static_cast<int>(b / subCount) - 1;
+        uint64_t sub = b % subCount + subCount;
+        return ((sub + 1) << shift) - 1;
+    }
+};
+
+#endif
@@ -4,7 +4,12 @@
 #include <iostream>
 #include <iterator>
 #include <functional>
-template<typename T>
+#include <memory>
+#include <new>
+#include "pool_allocator.h"
+//Nodes come from Allocator (rebound to the node type). The default
+//pool_allocator recycles erased nodes and hands them out from contiguous blocks
+template<typename T, typename Allocator = pool_allocator<T>>
 class basic_linked_list{
 	//Individual linked list element
 	//You can put classes inside classes
@@ -34,19 +39,38 @@ class basic_linked_list{
 		iterator(){}
 		iterator(element *c, element *t):current(c),tail(t){}
 	};
+	using node_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<element>;
 	size_t elements=0;
 	element *head=nullptr, *tail=nullptr;
+	node_allocator alloc;
+
+	//Get a node from the allocator and copy the item in
+	element *create_element(const T& in){
+		element *e = alloc.allocate(1);
+		new (e) element(in);
+		return e;
+	}
+	//Destroy a node and hand it back to the allocator
+	void destroy_element(element *e){
+		e->~element();
+		alloc.deallocate(e,1);
+	}
 public:
+	basic_linked_list(){}
+	explicit basic_linked_list(const Allocator &a):alloc(a){}
+	basic_linked_list(const basic_linked_list&)=delete;
+	basic_linked_list& operator=(const basic_linked_list&)=delete;
+
 	//Add at end
 	void push_back(const T& in){
 		//If tail is null then no items so set up head and tail to be the new item
 		if(!tail){
-			head = new element(in);
+			head = create_element(in);
 			tail=head;
 			return;
 		}
 		//Create the new item
-		tail->next = new element(in);
+		tail->next = create_element(in);
 		//Set the new items "previous" link to the current last item
 		tail->next->prev = tail;
 		//Set the new last item to be the new item
@@ -56,11 +80,11 @@ public:
 	//Add at the beginning
 	void push_front(const T& in){
 		if (!head){
-			head = new element(in);
+			head = create_element(in);
 			tail = head;
 			return;
 		}
-		head->prev = new element(in);
+		head->prev = create_element(in);
 		head->prev->next = head;
 		head = head->prev;
 		elements++;
@@ -97,7 +121,7 @@ public:
 		otherit it;
 		int add=0;
 		for (it=first; it!=last;++it){
-			current->next = new element(*it);
+			current->next = create_element(*it);
 			current->next->prev=current;
 			current = current->next;
 			elements++;
@@ -123,9 +147,12 @@ public:
     element *current=head, *next;
     while(current){
       next=current->next;
-      delete current;
+      destroy_element(current);
       current = next;
     }
+    head=nullptr;
+    tail=nullptr;
+    elements=0;
 	}
 
 	iterator erase(iterator pos){
@@ -151,7 +178,7 @@ public:
 			pos.current->prev->next=nullptr;
 		}
 		iterator i(pos.current->next,tail);
-		delete pos.current;
+		destroy_element(pos.current);
 		elements --;
 		return i;
 	}
@@ -164,11 +191,20 @@ public:
 		return current;
 	}
 
+	//Walk the nodes in the order they sit in memory instead of list order.
+	//Touches the same elements as a range-for but streams through the
+	//allocator's blocks, which is kinder to the cache once the list has been
+	//shuffled by inserts and erases. Needs an allocator with for_each_allocated.
+	template <typename F>
+	void for_each_allocated(F f){
+		alloc.for_each_allocated([&](element &e){f(e.data);});
+	}
+
 };
 
 namespace std{
-	template <typename T>
-		size_t erase_if(basic_linked_list<T> &list, std::function<bool(T&)> pred){
+	template <typename T, typename Allocator>
+		size_t erase_if(basic_linked_list<T, Allocator> &list, std::function<bool(T&)> pred){
 			for(auto it=list.begin();it!=list.end();){
 				if (pred(*it)) {
 					it=list.erase(it);
@@ -0,0 +1,170 @@
+#ifndef NEIGHBOUR_LIST_H
+#define NEIGHBOUR_LIST_H
+#include <cstddef> //needed for size_t
+#include <vector>
+#include <algorithm>
+#include "particle.h"
+#include "thread_pool.h"
+#include "cell_list.h"
+
+// Verlet neighbour list in CSR form.
+// Particles are kept in the binned (cell) order of the last build: slot s
+// holds container index order[s], and its partners are the slots
+// neighbours[start[s]] .. neighbours[start[s+1]-1]. Positions are gathered
+// into x, y in slot order every step so the pair loop streams through
+// memory instead of chasing container indices.
+// Pairs are listed out to range + skin, so the list stays valid until some
+// particle has moved more than skin/2 since the build. Every pair is stored
+// from both ends so each particle's row can be summed by one thread.
+class neighbour_list {
+public:
+    double skin;
+    std::vector<size_t> start;      // Row offsets, one row per slot plus one
+    std::vector<size_t> neighbours; // Concatenated rows of slot indices
+    std::vector<size_t> order;      // Container index of each slot
+    std::vector<double> x, y;       // Current positions in slot order
+    size_t builds = 0;              // Number of rebuilds so far
+
+    explicit neighbour_list(double skin) : skin(skin) {}
+
+    // Force a rebuild on the next refresh(), e.g. after the container has
+    // been reordered
+    void invalidate() { valid = false; }
+
+    // Gather the current positions into slot order. Returns false if the
+    // list has to be rebuilt: the container changed, or a particle moved
+    // more than skin/2 since the build. Displacements use the minimum image,
+    // so a particle that wrapped around the box counts only the distance it
+    // actually travelled.
+    template <typename Container>
+    bool refresh(const Container& particles, thread_pool& pool) {
+        if (!valid || particles.size() != built_size) return false;
+        double limit = 0.25 * skin * skin; // (skin/2)^2
+        std::vector<char> stale(pool.size(), 0);
+        pool.parallel_for(order.size(), [&](size_t t, size_t begin, size_t end) {
+            for (size_t s = begin; s < end; ++s) {
+                const Particle& p = particles[order[s]];
+                x[s] = p.position[0];
+                y[s] = p.position[1];
+                double dx = minimumImage(x[s] - x0[s]);
+                double dy = minimumImage(y[s] - y0[s]);
+                if (dx * dx + dy * dy > limit || p.active != Active) stale[t] = 1;
+            }
+        });
+        for (char s : stale) {
+            if (s) return false;
+        }
+        return true;
+    }
+
+    // Rebuild from a cell list with cells range + skin wide.
+    // Each thread fills the rows of a contiguous block of cells, which is a
+    // contiguous block of slots, so the per-thread rows concatenate into the
+    // CSR arrays in slot order and the list is the same for any thread count.
+    template <typename Container>
+    void build(const Container& particles, double range, cell_list& cells, thread_pool& pool) {
+        double reach = range + skin;
+        double reach2 = reach * reach;
+        cells.build(particles, reach);
+        size_t ncells = static_cast<size_t>(cells.ncell) * cells.ncell;
+        size_t nslots = cells.order.size();
+
+        rows.resize(pool.size());
+        start.resize(nslots + 1);
+        start[0] = 0;
+        pool.parallel_for(ncells, [&](size_t t, size_t begin, size_t end) {
+            std::vector<size_t>& out = rows[t];
+            out.clear();
+            for (size_t c = begin; c < end; ++c) {
+                int cx = static_cast<int>(c % cells.ncell);
+                int cy = static_cast<int>(c / cells.ncell);
+                for (size_t i = cells.cell_start[c]; i < cells.cell_start[c + 1]; ++i) {
+                    double xi = cells.x[i], yi = cells.y[i];
+                    // Make room for every candidate so the append is branch-free
+                    size_t used = out.size();
+                    out.resize(used + cells.stencilSize(cx, cy));
+                    cells.forEachNeighbour(cx, cy, i, [&](size_t j) {
+                        double dx = minimumImage(xi - cells.x[j]);
+                        double dy = minimumImage(yi - cells.y[j]);
+                        out[used] = j;
+                        used += (dx * dx + dy * dy < reach2);
+                    });
+                    out.resize(used);
+                    start[i + 1] = used; // Relative to this thread's rows for now
+                }
+            }
+        });
+
+        // Offset each thread's row ends and concatenate the rows
+        size_t total = 0;
+        for (size_t t = 0; t < pool.size(); ++t) {
+            size_t begin, end;
+            pool.block(ncells, t, begin, end);
+            for (size_t s = cells.cell_start[begin]; s < cells.cell_start[end]; ++s) {
+                start[s + 1] += total;
+            }
+            total += rows[t].size();
+        }
+        neighbours.resize(total);
+        pool.parallel_for(ncells, [&](size_t t, size_t begin, size_t) {
+            std::copy(rows[t].begin(), rows[t].end(), neighbours.begin() + start[cells.cell_start[begin]]);
+        });
+
+        order = cells.order;
+        x = cells.x;
+        y = cells.y;
+        x0 = cells.x;
+        y0 = cells.y;
+        built_size = particles.size();
+        valid = true;
+        builds++;
+    }
+
+private:
+    std::vector<double> x0, y0;             // Positions at the last build, in slot order
+    std::vector<std::vector<size_t>> rows;  // Per-thread rows during a build
+    size_t built_size = 0;                  // Container size at the last build
+    bool valid = false;                     // Built, and the container has not been reordered since
+};
+
+// computeForces() using a Verlet list, rebuilt only when refresh() says so.
+// Inactive particles are not binned, so their accNext is left untouched, as
+// with the cell-list version.
+template <typename Container>
+double computeForces(Container& particles, const force_params& params, neighbour_list& list,
+                     cell_list& cells, thread_pool& pool) {
+    double range = params.range();
+    double range2 = range * range;
+    if (!list.refresh(particles, pool)) list.build(particles, range, cells, pool);
+
+    std::vector<double> energy(pool.size(), 0.0);
+    pool.parallel_for(list.order.size(), [&](size_t t, size_t begin, size_t end) {
+        double localEnergy = 0.0;
+        for (size_t s = begin; s < end; ++s) {
+            double xi = list.x[s], yi = list.y[s];
+            double fx = 0.0, fy = 0.0;
+            for (size_t k = list.start[s]; k < list.start[s + 1]; ++k) {
+                size_t j = list.neighbours[k];
+                double dx = minimumImage(xi - list.x[j]);
+                double dy = minimumImage(yi - list.y[j]);
+                double r2 = dx * dx + dy * dy;
+                if (r2 >= range2) continue;
+                double e;
+                double f = pairForce(params, r2, e);
+                fx += f * dx;
+                fy += f * dy;
+                localEnergy += 0.5 * e; // Each pair is visited from both ends
+            }
+            Particle& p = particles[list.order[s]];
+            p.accNext[0] = fx;
+            p.accNext[1] = fy;
+        }
+        energy[t] = localEnergy;
+    });
+
+    double total = 0.0;
+    for (double e : energy) total += e;
+    return total;
+}
+
+#endif
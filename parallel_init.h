@@ -0,0 +1,139 @@
+#ifndef PARALLEL_INIT_H
+#define PARALLEL_INIT_H
+#include <cstddef> //needed for size_t
+#include <cstdint>
+#include <algorithm>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "particle.h"
+#include "particle_soa.h"
+#include "thread_pool.h"
+#include "philox.h"
+
+// std::allocator that default-initialises instead of value-initialising, so
+// resize() of a vector of trivial elements such as Particle leaves the new
+// slots untouched rather than zeroing them on the calling thread
+template <typename T>
+struct default_init_allocator : std::allocator<T> {
+    template <typename U>
+    struct rebind {
+        using other = default_init_allocator<U>;
+    };
+
+    default_init_allocator() = default;
+    template <typename U>
+    default_init_allocator(const default_init_allocator<U>&) noexcept {}
+
+    template <typename U>
+    void construct(U* p) noexcept(std::is_nothrow_default_constructible_v<U>) {
+        ::new (static_cast<void*>(p)) U;
+    }
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args) {
+        std::allocator_traits<std::allocator<T>>::construct(static_cast<std::allocator<T>&>(*this), p, std::forward<Args>(args)...);
+    }
+};
+
+// Particle storage for large runs set up by initParticlesParallel()
+using particle_vector = std::vector<Particle, default_init_allocator<Particle>>;
+
+// Starting state of particles [first, first + count), count <= 16, into
+// separate arrays. Particle i takes its position from Philox block
+// (i, 0, PhiloxInitPosition) and its velocity from (i, 0, PhiloxInitVelocity)
+// of seed, so its values depend on nothing but seed and i. The loop has no
+// branches or calls once philox4x32() is inlined, so the compiler
+// vectorises it across the particles of the batch.
+inline void initBatch(uint64_t seed, size_t first, size_t count, double* x, double* y, double* vx, double* vy) {
+    for (size_t k = 0; k < count; ++k) {
+        uint64_t i = first + k;
+        uint32_t lo = static_cast<uint32_t>(i), hi = static_cast<uint32_t>(i >> 32);
+        philox_block p = philox4x32(lo, hi, 0, PhiloxInitPosition, seed);
+        philox_block v = philox4x32(lo, hi, 0, PhiloxInitVelocity, seed);
+        x[k] = philoxUniform(p.w[0], p.w[1]);
+        y[k] = philoxUniform(p.w[2], p.w[3]);
+        vx[k] = -0.1 + 0.2 * philoxUniform(v.w[0], v.w[1]);
+        vy[k] = -0.1 + 0.2 * philoxUniform(v.w[2], v.w[3]);
+    }
+}
+
+// Particle id at rest with the given position and velocity
+inline void setParticle(Particle& p, size_t id, double x, double y, double vx, double vy) {
+    p.label = 0;
+    p.id = static_cast<uint32_t>(id);
+    p.position[0] = x;
+    p.position[1] = y;
+    p.velocity[0] = vx;
+    p.velocity[1] = vy;
+    p.acceleration[0] = p.acceleration[1] = 0.0;
+    p.accNext[0] = p.accNext[1] = 0.0;
+    p.wrapX = false;
+    p.wrapY = false;
+    p.active = Active;
+}
+
+// Replace the contents of particles with n particles drawn from seed:
+// positions uniform in the unit box, velocities uniform in [-0.1, 0.1), at
+// rest otherwise, ids 0 .. n-1. For random-access containers (std::vector,
+// basic_vector) the pool fills its blocks in parallel, and since every
+// particle is a function of (seed, index) alone the result is the same for
+// any number of threads. basic_vector and particle_vector grow without
+// touching the new storage, so each thread also does the first touch of its
+// own block; a plain std::vector<Particle> zeroes it all on this thread first.
+// Lists are appended to in order on this thread, with the same values.
+template <typename Container>
+void initParticlesParallel(Container& particles, size_t n, uint64_t seed, thread_pool& pool) {
+    particles.clear();
+    if constexpr (!requires { particles.resize(n); particles[0]; }) {
+        double x[16], y[16], vx[16], vy[16];
+        for (size_t first = 0; first < n; first += 16) {
+            size_t count = std::min<size_t>(16, n - first);
+            initBatch(seed, first, count, x, y, vx, vy);
+            for (size_t k = 0; k < count; ++k) {
+                Particle p;
+                setParticle(p, first + k, x[k], y[k], vx[k], vy[k]);
+                particles.push_back(p);
+            }
+        }
+    } else {
+        if constexpr (requires { particles.resize_uninitialized(n); }) {
+            particles.resize_uninitialized(n);
+        } else {
+            particles.resize(n);
+        }
+        pool.parallel_for(n, [&](size_t, size_t begin, size_t end) {
+            double x[16], y[16], vx[16], vy[16];
+            for (size_t first = begin; first < end; first += 16) {
+                size_t count = std::min<size_t>(16, end - first);
+                initBatch(seed, first, count, x, y, vx, vy);
+                for (size_t k = 0; k < count; ++k) {
+                    setParticle(particles[first + k], first + k, x[k], y[k], vx[k], vy[k]);
+                }
+            }
+        });
+    }
+}
+
+// The SoA store is filled array by array straight from the batches, and
+// resize() leaves the storage untouched, so each thread also does the first
+// touch of its own block. Same values as the AoS version.
+inline void initParticlesParallel(particle_soa& particles, size_t n, uint64_t seed, thread_pool& pool) {
+    particles.clear();
+    particles.resize(n);
+    unsigned char active = packState(false, false, Active);
+    pool.parallel_for(n, [&](size_t, size_t begin, size_t end) {
+        for (size_t first = begin; first < end; first += 16) {
+            size_t count = std::min<size_t>(16, end - first);
+            initBatch(seed, first, count, particles.x + first, particles.y + first, particles.vx + first, particles.vy + first);
+        }
+        std::fill(particles.ax + begin, particles.ax + end, 0.0);
+        std::fill(particles.ay + begin, particles.ay + end, 0.0);
+        std::fill(particles.axNext + begin, particles.axNext + end, 0.0);
+        std::fill(particles.ayNext + begin, particles.ayNext + end, 0.0);
+        std::fill(particles.state + begin, particles.state + end, active);
+    });
+}
+
+#endif
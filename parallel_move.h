@@ -0,0 +1,65 @@
+#ifndef PARALLEL_MOVE_H
+#define PARALLEL_MOVE_H
+#include <cstddef> //needed for size_t
+#include <vector>
+#include "particle.h"
+#include "particle_soa.h"
+#include "thread_pool.h"
+#include "trace_recorder.h"
+
+// Per-thread buffer of particles that wrapped during a step.
+// Aligned to a cache line so workers appending to neighbouring buffers do
+// not share one.
+struct alignas(64) migration_buffer {
+    std::vector<Particle> particles;
+};
+
+// Parallel version of moveParticles() + migrateParticles() for containers
+// with random access (std::vector, basic_vector).
+// Each thread moves a contiguous block and collects its wrapped particles in
+// its own buffer. The buffers are then appended in thread order, which is the
+// same order the serial migrateParticles() produces, so the result is bit
+// identical to the serial path for any thread count.
+// With a trace, each thread's block and the merge are recorded.
+// Returns the number of particles that were migrated.
+template <typename Container>
+size_t moveParticlesParallel(Container& particles, double dt, thread_pool& pool,
+                             std::vector<migration_buffer>& buffers, trace_recorder* trace = nullptr) {
+    buffers.resize(pool.size());
+    size_t n = particles.size();
+    pool.parallel_for(n, [&](size_t t, size_t begin, size_t end) {
+        trace_scope scope(trace, t, PhaseIntegrate);
+        std::vector<Particle>& out = buffers[t].particles;
+        out.clear();
+        for (size_t i = begin; i < end; ++i) {
+            Particle& particle = particles[i];
+            if (particle.active != Active) continue;
+            moveParticle(particle, dt);
+            if (particle.wrapX || particle.wrapY) {
+                out.push_back(particle);
+                particle.active = Removed;
+            }
+        }
+    });
+
+    // Merge the buffers with a single reservation
+    trace_scope scope(trace, 0, PhaseMigrate);
+    size_t migrated = 0;
+    for (auto& buffer : buffers) migrated += buffer.particles.size();
+    if (migrated == 0) return 0;
+    particles.reserve(n + migrated);
+    for (auto& buffer : buffers) {
+        if (buffer.particles.empty()) continue;
+        particles.insert(particles.end(), buffer.particles.begin(), buffer.particles.end());
+    }
+    return migrated;
+}
+
+// The SoA store wraps particles in place, so each thread just moves its block
+inline void moveParticlesParallel(particle_soa& particles, double dt, thread_pool& pool) {
+    pool.parallel_for(particles.size(), [&](size_t, size_t begin, size_t end) {
+        moveParticles(particles, begin, end, dt);
+    });
+}
+
+#endif
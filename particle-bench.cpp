@@ -0,0 +1,332 @@
+// Benchmark driver comparing the particle containers used by the sims.
+// Every (container, particles, iterations, N) combination is run "repeats"
+// times, each run in a forked child so that peak RSS is per run.
+// Results are written to stdout as CSV.
+//
+// Usage: particle-bench [--containers vector,list,linked_list,linked_list_malloc,basic_vector,chunk_list,soa]
+//                       [--particles 10000,1000000] [--iterations 100]
+//                       [--N 1,10] [--threads 1,4] [--chunk-sizes 100,adaptive]
+//                       [--modes ordered,unordered] [--repeats 3]
+// std::list, basic_linked_list and chunk_list always run on one thread.
+// linked_list uses the default pooled allocator, linked_list_malloc uses
+// std::allocator for comparison.
+// --chunk-sizes only applies to chunk_list. "adaptive" grows chunks
+// geometrically from 64 up to 65536 elements.
+// The unordered mode (AoS containers only) wraps particles in place instead
+// of the tempvec migration; nothing leaves the container, so it never
+// erases either. particle_soa always works that way.
+#include <iostream>
+#include <vector>
+#include <list>
+#include <string>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include "particle.h"
+#include "linked_list.h"
+#include "svector.h"
+#include "chunk_list.h"
+#include "particle_soa.h"
+#include "thread_pool.h"
+#include "parallel_move.h"
+#include "parallel_init.h"
+
+struct RunConfig {
+    std::string container;
+    size_t particles;
+    int iterations;
+    int N;
+    size_t threads;
+    size_t chunkSize; // chunk_list only, 0 means adaptive
+    bool unordered;   // In-place wrap instead of migration and erase
+};
+
+// Apply per-container settings before the particles are created
+template <typename Container>
+void configureContainer(Container&, const RunConfig&) {}
+
+void configureContainer(chunk_list<Particle>& particles, const RunConfig& config) {
+    if (config.chunkSize == 0) {
+        particles.set_policy(chunk_policy::adaptive(64, 65536));
+    } else {
+        particles.set_policy(chunk_policy::fixed(config.chunkSize));
+    }
+}
+
+// Periodically erase inactive particles, using each container's own erase
+void eraseInactive(std::vector<Particle>& particles) {
+    std::erase_if(particles, [](const Particle& p) { return p.active != Active; });
+}
+
+void eraseInactive(std::list<Particle>& particles) {
+    std::erase_if(particles, [](const Particle& p) { return p.active != Active; });
+}
+
+template <typename Allocator>
+void eraseInactive(basic_linked_list<Particle, Allocator>& particles) {
+    std::erase_if(particles, std::function<bool(Particle&)>([](Particle& p) { return p.active != Active; }));
+}
+
+void eraseInactive(chunk_list<Particle>& particles) {
+    std::erase_if(particles, std::function<bool(Particle&)>([](Particle& p) { return p.active != Active; }));
+}
+
+void eraseInactive(basic_vector<Particle>& particles) {
+    std::erase_if(particles, [](const Particle& p) { return p.active != Active; });
+}
+
+void eraseInactive(particle_soa& particles) {
+    particles.erase_inactive();
+}
+
+// The pooled list is updated in allocation order, which gives the same result
+// as list order because each particle's update is independent
+void moveParticles(basic_linked_list<Particle>& particles, double dt) {
+    particles.for_each_allocated([dt](Particle& particle) {
+        if (particle.active != Active) return;
+        moveParticle(particle, dt);
+    });
+}
+
+// One move + migrate step. The list containers have no random access so
+// they always run serially; the others are split over the thread pool.
+template <typename Container>
+void stepParticles(Container& particles, double dt, thread_pool&,
+                   std::vector<Particle>& tempvec, std::vector<migration_buffer>&) {
+    moveParticles(particles, dt);
+    migrateParticles(particles, tempvec);
+}
+
+void stepParticles(std::vector<Particle>& particles, double dt, thread_pool& pool,
+                   std::vector<Particle>&, std::vector<migration_buffer>& buffers) {
+    moveParticlesParallel(particles, dt, pool, buffers);
+}
+
+void stepParticles(basic_vector<Particle>& particles, double dt, thread_pool& pool,
+                   std::vector<Particle>&, std::vector<migration_buffer>& buffers) {
+    moveParticlesParallel(particles, dt, pool, buffers);
+}
+
+// chunk_list also runs its bounded incremental compaction every step
+void stepParticles(chunk_list<Particle>& particles, double dt, thread_pool&,
+                   std::vector<Particle>& tempvec, std::vector<migration_buffer>&) {
+    moveParticles(particles, dt);
+    migrateParticles(particles, tempvec);
+    particles.compact_chunks(4);
+}
+
+// The SoA store wraps particles in place, so there is nothing to migrate
+void stepParticles(particle_soa& particles, double dt, thread_pool& pool,
+                   std::vector<Particle>&, std::vector<migration_buffer>&) {
+    moveParticlesParallel(particles, dt, pool);
+}
+
+// Run one simulation and return the wall time of every step in nanoseconds
+template <typename Container>
+std::vector<double> runSimulation(const RunConfig& config) {
+    thread_pool pool(config.threads);
+    Container particles;
+    configureContainer(particles, config);
+    // Same seed as the sims; the values do not depend on libc or threads
+    initParticlesParallel(particles, config.particles, 1691169547, pool);
+
+    std::vector<Particle> tempvec;
+    std::vector<migration_buffer> buffers;
+    std::vector<double> stepTimes;
+    stepTimes.reserve(config.iterations);
+    double dt = 0.01;
+
+    for (int i = 0; i < config.iterations; ++i) {
+        auto stepStart = std::chrono::steady_clock::now();
+        if (config.unordered) {
+            moveParticles(particles, dt);
+            auto stepEnd = std::chrono::steady_clock::now();
+            stepTimes.push_back(std::chrono::duration<double, std::nano>(stepEnd - stepStart).count());
+            continue;
+        }
+        stepParticles(particles, dt, pool, tempvec, buffers);
+        if (i % config.N == 0) {
+            eraseInactive(particles);
+        }
+        auto stepEnd = std::chrono::steady_clock::now();
+        stepTimes.push_back(std::chrono::duration<double, std::nano>(stepEnd - stepStart).count());
+    }
+    return stepTimes;
+}
+
+std::vector<double> runContainer(const RunConfig& config) {
+    if (config.container == "vector") return runSimulation<std::vector<Particle>>(config);
+    if (config.container == "list") return runSimulation<std::list<Particle>>(config);
+    if (config.container == "linked_list") return runSimulation<basic_linked_list<Particle>>(config);
+    if (config.container == "linked_list_malloc") return runSimulation<basic_linked_list<Particle, std::allocator<Particle>>>(config);
+    if (config.container == "basic_vector") return runSimulation<basic_vector<Particle>>(config);
+    if (config.container == "chunk_list") return runSimulation<chunk_list<Particle>>(config);
+    if (config.container == "soa") return runSimulation<particle_soa>(config);
+    std::cerr << "Unknown container: " << config.container << "\n";
+    exit(1);
+}
+
+// Run a single repeat in a child process. The child streams its step times
+// back through a pipe; the parent collects them and the child's peak RSS.
+bool runForked(const RunConfig& config, std::vector<double>& stepTimes, long& peakRssKb) {
+    int fds[2];
+    if (pipe(fds) != 0) return false;
+    pid_t pid = fork();
+    if (pid < 0) return false;
+    if (pid == 0) {
+        close(fds[0]);
+        std::vector<double> times = runContainer(config);
+        const char* data = reinterpret_cast<const char*>(times.data());
+        size_t remaining = times.size() * sizeof(double);
+        while (remaining > 0) {
+            ssize_t written = write(fds[1], data, remaining);
+            if (written <= 0) _exit(1);
+            data += written;
+            remaining -= written;
+        }
+        close(fds[1]);
+        _exit(0);
+    }
+    close(fds[1]);
+    std::vector<char> buffer;
+    char chunk[65536];
+    ssize_t got;
+    while ((got = read(fds[0], chunk, sizeof(chunk))) > 0) {
+        buffer.insert(buffer.end(), chunk, chunk + got);
+    }
+    close(fds[0]);
+
+    int status = 0;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) != pid) return false;
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) return false;
+
+    size_t count = buffer.size() / sizeof(double);
+    size_t offset = stepTimes.size();
+    stepTimes.resize(offset + count);
+    memcpy(stepTimes.data() + offset, buffer.data(), count * sizeof(double));
+    peakRssKb = std::max(peakRssKb, usage.ru_maxrss);
+    return true;
+}
+
+// Value at fraction q (0..1) of a sorted sample
+double percentile(const std::vector<double>& sorted, double q) {
+    if (sorted.empty()) return 0.0;
+    size_t index = static_cast<size_t>(q * (sorted.size() - 1) + 0.5);
+    return sorted[index];
+}
+
+template <typename T>
+std::vector<T> parseList(const std::string& arg) {
+    std::vector<T> values;
+    std::stringstream stream(arg);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        std::stringstream itemStream(item);
+        T value;
+        itemStream >> value;
+        values.push_back(value);
+    }
+    return values;
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> containers = {"vector", "list", "linked_list", "basic_vector", "chunk_list", "soa"};
+    std::vector<size_t> particleCounts = {10000, 1000000};
+    std::vector<int> iterationCounts = {100};
+    std::vector<int> eraseIntervals = {1, 10};
+    std::vector<size_t> threadCounts = {1};
+    std::vector<size_t> chunkSizes = {100};
+    std::vector<std::string> modes = {"ordered"};
+    int repeats = 3;
+
+    for (int a = 1; a < argc; ++a) {
+        std::string arg = argv[a];
+        if (a + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << "\n";
+            exit(1);
+        }
+        std::string value = argv[++a];
+        if (arg == "--containers") containers = parseList<std::string>(value);
+        else if (arg == "--particles") particleCounts = parseList<size_t>(value);
+        else if (arg == "--iterations") iterationCounts = parseList<int>(value);
+        else if (arg == "--N") eraseIntervals = parseList<int>(value);
+        else if (arg == "--threads") threadCounts = parseList<size_t>(value);
+        else if (arg == "--chunk-sizes") {
+            chunkSizes.clear();
+            for (const auto& size : parseList<std::string>(value)) {
+                chunkSizes.push_back(size == "adaptive" ? 0 : std::stoul(size));
+            }
+        }
+        else if (arg == "--modes") modes = parseList<std::string>(value);
+        else if (arg == "--repeats") repeats = std::atoi(value.c_str());
+        else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--containers a,b] [--particles n,m] [--iterations n,m] [--N n,m] [--threads n,m] [--chunk-sizes n,adaptive] [--modes ordered,unordered] [--repeats r]\n";
+            exit(1);
+        }
+    }
+    for (int N : eraseIntervals) {
+        if (N <= 0) {
+            std::cerr << "N must be positive\n";
+            exit(1);
+        }
+    }
+
+    std::vector<RunConfig> configs;
+    for (const auto& container : containers) {
+        // Chunk size only means something for chunk_list
+        std::vector<size_t> sizes = (container == "chunk_list") ? chunkSizes : std::vector<size_t>{100};
+        // The SoA store already wraps in place
+        bool canUnorder = (container != "soa");
+        for (size_t particles : particleCounts) {
+            for (int iterations : iterationCounts) {
+                for (int N : eraseIntervals) {
+                    for (size_t threads : threadCounts) {
+                        for (size_t chunkSize : sizes) {
+                            for (const auto& mode : modes) {
+                                if (mode == "unordered" && !canUnorder) continue;
+                                configs.push_back(RunConfig{container, particles, iterations, N, threads, chunkSize,
+                                                            mode == "unordered"});
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    std::cout << "container,mode,chunk_size,particles,iterations,N,threads,repeats,median_step_us,p95_step_us,ns_per_particle,peak_rss_kb\n";
+    for (const auto& config : configs) {
+        std::vector<double> stepTimes;
+        long peakRssKb = 0;
+        bool ok = true;
+        for (int r = 0; r < repeats && ok; ++r) {
+            ok = runForked(config, stepTimes, peakRssKb);
+        }
+        std::string chunkSize = "";
+        if (config.container == "chunk_list") {
+            chunkSize = config.chunkSize == 0 ? "adaptive" : std::to_string(config.chunkSize);
+        }
+        if (!ok) {
+            std::cerr << "Run failed: " << config.container << " " << chunkSize << " " << config.particles << " "
+                      << config.iterations << " " << config.N << " " << config.threads << "\n";
+            continue;
+        }
+        std::sort(stepTimes.begin(), stepTimes.end());
+        double median = percentile(stepTimes, 0.5);
+        double p95 = percentile(stepTimes, 0.95);
+        std::cout << config.container << "," << (config.unordered ? "unordered" : "ordered") << "," << chunkSize << "," << config.particles << "," << config.iterations << ","
+                  << config.N << "," << config.threads << "," << repeats << "," << median / 1000.0 << ","
+                  << p95 / 1000.0 << "," << median / config.particles << "," << peakRssKb << "\n";
+        std::cout.flush();
+    }
+
+    return 0;
+}
@@ -33,52 +33,44 @@ double genRN(double min, double max) {
 void moveParticles(basic_vector<Particle>& particles, double dt, int iteration) {
     int inactiveCount = 0; // Count of inactive particles
 
-    for (auto it = particles.begin(); it != particles.end();) {
-        Particle& particle = *it;
+    // Erase the particles flagged last step in one pass
+    inactiveCount += std::erase_if(particles, [](const Particle& p) { return p.active != Active; });
 
-        if (particle.active != Active) {
-            it = particles.erase(it); // Erase and get the next iterator
+    for (auto& particle : particles) {
+        particle.wrapX = false;
+        particle.wrapY = false;
+
+        particle.position[0] += particle.velocity[0] * dt + 0.5 * particle.acceleration[0] * dt * dt;
+        particle.position[1] += particle.velocity[1] * dt + 0.5 * particle.acceleration[1] * dt * dt;
+
+        if (particle.position[0] < 0) {
+            particle.position[0] += 1;
+            particle.wrapX = true;
+        }
+        if (particle.position[0] >= 1) {
+            particle.position[0] -= 1;
+            particle.wrapX = true;
+        }
+        if (particle.position[1] < 0) {
+            particle.position[1] += 1;
+            particle.wrapY = true;
+        }
+        if (particle.position[1] >= 1) {
+            particle.position[1] -= 1;
+            particle.wrapY = true;
+        }
+
+        particle.velocity[0] += 0.5 * (particle.acceleration[0] + particle.accNext[0]) * dt;
+        particle.velocity[1] += 0.5 * (particle.acceleration[1] + particle.accNext[1]) * dt;
+
+        particle.acceleration[0] = particle.accNext[0];
+        particle.acceleration[1] = particle.accNext[1];
+
+        if (particle.wrapX || particle.wrapY) {
+            particle.active = Removing;
             inactiveCount++;
-        } else {
-            particle.wrapX = false;
-            particle.wrapY = false;
-
-            particle.position[0] += particle.velocity[0] * dt + 0.5 * particle.acceleration[0] * dt * dt;
-            particle.position[1] += particle.velocity[1] * dt + 0.5 * particle.acceleration[1] * dt * dt;
-
-            if (particle.position[0] < 0) {
-                particle.position[0] += 1;
-                particle.wrapX = true;
-            }
-            if (particle.position[0] >= 1) {
-                particle.position[0] -= 1;
-                particle.wrapX = true;
-            }
-            if (particle.position[1] < 0) {
-                particle.position[1] += 1;
-                particle.wrapY = true;
-            }
-            if (particle.position[1] >= 1) {
-                particle.position[1] -= 1;
-                particle.wrapY = true;
-            }
-
-            particle.velocity[0] += 0.5 * (particle.acceleration[0] + particle.accNext[0]) * dt;
-            particle.velocity[1] += 0.5 * (particle.acceleration[1] + particle.accNext[1]) * dt;
-
-            particle.acceleration[0] = particle.accNext[0];
-            particle.acceleration[1] = particle.accNext[1];
-
-            if (particle.wrapX || particle.wrapY) {
-                particle.active = Removing;
-                inactiveCount++;
-            }
-
-            ++it;
         }
     }
-
-    
 }
 
 int main(int argc, char** argv) {
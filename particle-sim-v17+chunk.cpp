@@ -6,6 +6,7 @@
 #include <algorithm>
 #include <chrono>
 #include "chunk_list.h"
+#include "latency_histogram.h"
 
 enum ActiveState {
     Active,
@@ -25,6 +26,7 @@ struct Particle {
 };
 
 int N = 1; // Number of iterations between erasing particles
+int K = 4; // Chunks examined per step by the incremental compaction
 
 double genRN(double min, double max) {
     return min + static_cast<double>(rand()) / RAND_MAX * (max - min);
@@ -86,15 +88,17 @@ void moveParticles(chunk_list<Particle>& particles, double dt, int iteration) {
 }
 
 int main(int argc, char** argv) {
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " N" << "\n";
+    if (argc != 2 && argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " N [chunk size, 0 for adaptive]" << "\n";
         exit(1);
     }
     N = std::atoi(argv[1]);
+    size_t chunkSize = 100;
+    if (argc == 3) chunkSize = std::atoi(argv[2]);
     srand(1691169547); // Set fixed seed for random number generation
 
     // Create particles with unique labels
-    chunk_list<Particle> particles;
+    chunk_list<Particle> particles(chunkSize == 0 ? chunk_policy::adaptive(64, 65536) : chunk_policy::fixed(chunkSize));
     for (int i = 0; i < 10000; i++) {
         Particle particle;
         particle.position[0] = genRN(0.0, 1.0);
@@ -117,10 +121,17 @@ int main(int argc, char** argv) {
     // Starting the runtime clock
     auto runtimeStart = std::chrono::high_resolution_clock::now();
 
+    // Tail latency shows the compaction spikes that the runtime averages out
+    latency_histogram stepLatency;
+
     // Move particles for 100 iterations
     for (int i = 0; i < 100000; ++i) {
+        auto stepStart = std::chrono::steady_clock::now();
         moveParticles(particles, dt, i);
 
+        // Bounded compaction instead of a full pack_chunks
+        particles.compact_chunks(K);
+
         #ifdef DEBUG
         if (particles.size() > 3000) exit(1);
         #endif
@@ -135,12 +146,14 @@ int main(int argc, char** argv) {
             positionFile << "\n";
             #endif
         }
+        stepLatency.record(std::chrono::steady_clock::now() - stepStart);
     }
 
     auto runtimeEnd = std::chrono::high_resolution_clock::now();
     auto runtimeTotal = std::chrono::duration_cast<std::chrono::milliseconds>(runtimeEnd - runtimeStart).count();
 
     std::cout << "Simulation Runtime: " << runtimeTotal << " ms\n";
+    stepLatency.report(std::cout, "Step");
 
     // Close "particle-positions.txt"
     positionFile.close();
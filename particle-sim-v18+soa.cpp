@@ -0,0 +1,82 @@
+#include <iostream>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include "particle.h"
+#include "particle_soa.h"
+#include "trajectory.h"
+#include "thread_pool.h"
+#include "parallel_init.h"
+
+int N = 1; // Number of iterations between erasing particles
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 4) {
+        std::cerr << "Usage: " << argv[0] << " N [trajectory-file [every]]" << "\n";
+        exit(1);
+    }
+    N = std::atoi(argv[1]);
+    // Binary trajectory with positions and flags every "every" steps
+    const char* trajectoryPath = argc >= 3 ? argv[2] : nullptr;
+    int every = argc == 4 ? std::atoi(argv[3]) : 100;
+
+    // Same particles as v19 and v21, straight into separate arrays
+    particle_soa particles;
+    {
+        thread_pool pool(std::thread::hardware_concurrency());
+        initParticlesParallel(particles, 10000, 1691169547, pool);
+    }
+
+    // Time step
+    double dt = 0.01;
+
+    std::ofstream positionFile("particle-positions.txt");
+    std::unique_ptr<trajectory_writer> trajectory;
+    if (trajectoryPath) trajectory = std::make_unique<trajectory_writer>(trajectoryPath, TrajectoryFlags, dt);
+
+    // Starting the runtime clock
+    auto runtimeStart = std::chrono::high_resolution_clock::now();
+
+    // Move particles for 100 iterations
+    for (int i = 0; i < 100000; ++i) {
+        // Wrapped particles stay in place, so there is no tempvec to fill
+        moveParticles(particles, dt);
+
+        // Periodically erase inactive particles
+        if (i % N == 0) {
+            particles.erase_inactive();
+        }
+
+        #ifdef DEBUG
+        if (particles.size() > 3000) exit(1);
+        #endif
+
+        if (trajectory && every > 0 && i % every == 0) trajectory->writeFrame(i, particles);
+
+        // Writes particle positions to "particle-positions.txt"
+        #ifdef DEBUG
+        for (size_t p = 0; p < particles.size(); ++p) {
+            if (stateActive(particles.state[p]) != Active) continue;
+            positionFile << particles.x[p] << " " << particles.y[p];
+            if (particles.state[p] & StateWrapX) positionFile << "  (Wrapped-X)";
+            if (particles.state[p] & StateWrapY) positionFile << "  (Wrapped-Y)";
+            positionFile << "\n";
+        }
+        #endif
+    }
+
+    auto runtimeEnd = std::chrono::high_resolution_clock::now();
+    auto runtimeTotal = std::chrono::duration_cast<std::chrono::milliseconds>(runtimeEnd - runtimeStart).count();
+
+    std::cout << "Simulation Runtime: " << runtimeTotal << " ms\n";
+
+    // Close "particle-positions.txt"
+    positionFile.close();
+    if (trajectory) trajectory->close();
+
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <memory>
+#include "particle.h"
+#include "thread_pool.h"
+#include "parallel_move.h"
+#include "trace_recorder.h"
+#include "parallel_init.h"
+
+int N = 1; // Number of iterations between erasing particles
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 5) {
+        std::cerr << "Usage: " << argv[0] << " N [threads [trace-file [every]]]" << "\n";
+        exit(1);
+    }
+    N = std::atoi(argv[1]);
+    size_t threads = std::thread::hardware_concurrency();
+    if (argc >= 3) threads = std::atoi(argv[2]);
+    // Chrome trace of the phases of every "every"-th step, per thread
+    const char* tracePath = argc >= 4 ? argv[3] : nullptr;
+    uint64_t traceEvery = argc == 5 ? std::atoi(argv[4]) : 1000;
+    thread_pool pool(threads);
+
+    // Counter-based: the same particles for any thread count
+    std::vector<Particle> particles;
+    initParticlesParallel(particles, 10000, 1691169547, pool);
+    std::vector<migration_buffer> buffers;
+    std::unique_ptr<trace_recorder> trace;
+    if (tracePath) trace = std::make_unique<trace_recorder>(pool.size(), 1 << 16, traceEvery);
+
+    // Time step
+    double dt = 0.01;
+
+    std::ofstream positionFile("particle-positions.txt");
+
+    // Starting the runtime clock
+    auto runtimeStart = std::chrono::high_resolution_clock::now();
+
+    // Move particles for 100 iterations
+    for (int i = 0; i < 100000; ++i) {
+        if (trace) trace->beginStep(i);
+
+        // Move in parallel and re-append wrapped particles from the per-thread buffers
+        moveParticlesParallel(particles, dt, pool, buffers, trace.get());
+
+        // Periodically erase inactive particles
+        if (i % N == 0) {
+            trace_scope scope(trace.get(), 0, PhaseErase);
+            std::erase_if(particles, [](const Particle& p) { return p.active != Active; });
+        }
+
+        #ifdef DEBUG
+        if (particles.size() > 3000) exit(1);
+        #endif
+
+        // Writes particle positions to "particle-positions.txt"
+        trace_scope output(trace.get(), 0, PhaseOutput);
+        for (const auto& particle : particles) {
+            if (particle.active != Active) continue;
+            #ifdef DEBUG
+            positionFile << particle.label << " " << particle.position[0] << " " << particle.position[1];
+            if (particle.wrapX) positionFile << "  (Wrapped-X)";
+            if (particle.wrapY) positionFile << "  (Wrapped-Y)";
+            positionFile << "\n";
+            #endif
+        }
+    }
+
+    auto runtimeEnd = std::chrono::high_resolution_clock::now();
+    auto runtimeTotal = std::chrono::duration_cast<std::chrono::milliseconds>(runtimeEnd - runtimeStart).count();
+
+    std::cout << "Simulation Runtime: " << runtimeTotal << " ms on " << pool.size() << " threads\n";
+    if (trace) {
+        trace->write(tracePath);
+        if (trace->dropped() > 0) std::cout << "Trace events dropped: " << trace->dropped() << "\n";
+    }
+
+    // Close "particle-positions.txt"
+    positionFile.close();
+
+    return 0;
+}
@@ -0,0 +1,186 @@
+#include <iostream>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <memory>
+#include "particle.h"
+#include "svector.h"
+#include "checkpoint.h"
+#include "phase_profile.h"
+#include "latency_histogram.h"
+
+int N = 1; // Number of iterations between erasing particles
+
+// Usage: particle-sim-v20+swap N [ordered|unordered] [--steps 100000]
+//                             [--checkpoint file] [--checkpoint-every K] [--restart file]
+//                             [--profile file.csv|file.json] [--profile-every 1000] [--profile-counters 0|1]
+//
+// --checkpoint writes the full state to file every K steps and after the
+// last one; --restart carries on from such a file, drawing the same random
+// numbers and producing the same particles bit for bit as the run that
+// wrote it. The restart keeps the checkpoint's N and mode; naming the
+// other mode is an error.
+//
+// --profile records the time spent in each phase of the step, summed over
+// windows of --profile-every steps, and with --profile-counters 1 the
+// hardware counters too. It needs a build with -DUSE_PROFILE; without it
+// the timers compile to nothing. Step latency percentiles are always
+// reported, per phase as well with --profile.
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " N [ordered|unordered] [--steps n]"
+                  << " [--checkpoint file] [--checkpoint-every K] [--restart file]"
+                  << " [--profile file] [--profile-every n] [--profile-counters 0|1]" << "\n";
+        exit(1);
+    }
+    N = std::atoi(argv[1]);
+    // unordered wraps particles in place, so nothing ever leaves the
+    // container and there is nothing to remove; ordered copies wrapped
+    // particles out and re-appends them as v17 does, then erases the
+    // originals every N steps
+    int a = 2;
+    bool unordered = false;
+    bool modeGiven = false;
+    if (a < argc && (std::string(argv[a]) == "unordered" || std::string(argv[a]) == "ordered")) {
+        unordered = std::string(argv[a++]) == "unordered";
+        modeGiven = true;
+    }
+    long steps = 100000;
+    std::string checkpointPath, restartPath;
+    long checkpointEvery = 10000;
+    std::string profilePath;
+    long profileEvery = 1000;
+    bool profileCounters = false;
+    for (; a < argc; ++a) {
+        std::string arg = argv[a];
+        if (a + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << "\n";
+            exit(1);
+        }
+        std::string value = argv[++a];
+        if (arg == "--steps") steps = std::stol(value);
+        else if (arg == "--checkpoint") checkpointPath = value;
+        else if (arg == "--checkpoint-every") checkpointEvery = std::stol(value);
+        else if (arg == "--restart") restartPath = value;
+        else if (arg == "--profile") profilePath = value;
+        else if (arg == "--profile-every") profileEvery = std::stol(value);
+        else if (arg == "--profile-counters") profileCounters = (value == "1");
+        else {
+            std::cerr << "Unknown option " << arg << "\n";
+            exit(1);
+        }
+    }
+
+    basic_vector<Particle> particles;
+    particles.reserve(10000);
+    checkpoint_state state;
+    state.eraseInterval = N;
+    state.mode = unordered ? 1 : 0;
+    if (restartPath.empty()) {
+        state.rng.seed(1691169547); // Set fixed seed for random number generation
+        initParticles(particles, 10000, state.rng);
+    } else {
+        readCheckpoint(restartPath, particles, state);
+        N = static_cast<int>(state.eraseInterval);
+        // The two modes store particles in different orders, so a restart
+        // carries on in the checkpoint's mode
+        bool restoredUnordered = state.mode == 1;
+        if (modeGiven && restoredUnordered != unordered) {
+            std::cerr << restartPath << " was written in " << (restoredUnordered ? "unordered" : "ordered")
+                      << " mode, which a restart cannot change\n";
+            exit(1);
+        }
+        unordered = restoredUnordered;
+        std::cout << "Restarted at step " << state.step << " with " << particles.size() << " particles\n";
+    }
+
+    std::vector<Particle> tempvec;
+
+    // Time step
+    double dt = 0.01;
+
+    std::ofstream positionFile("particle-positions.txt");
+
+    std::unique_ptr<phase_profiler> profile;
+    if (!profilePath.empty()) {
+        if (!phase_profiler::enabled) std::cerr << "Built without USE_PROFILE, --profile is ignored\n";
+        profile = std::make_unique<phase_profiler>(profilePath, profileEvery, profileCounters);
+        if (profileCounters && phase_profiler::enabled && !profile->countersEnabled()) {
+            std::cerr << "Hardware counters are not available, recording time only\n";
+        }
+    }
+
+    // Starting the runtime clock
+    auto runtimeStart = std::chrono::high_resolution_clock::now();
+
+    latency_histogram stepLatency;
+
+    // Move particles for the remaining iterations
+    for (long i = static_cast<long>(state.step); i < steps; ++i) {
+        auto stepStart = std::chrono::steady_clock::now();
+        if (unordered) {
+            // Wrapped particles keep their slot: no migration, no erase
+            phase_scope scope(profile.get(), PhaseIntegrate);
+            moveParticles(particles, dt);
+        } else {
+            {
+                phase_scope scope(profile.get(), PhaseIntegrate);
+                moveParticles(particles, dt);
+            }
+            {
+                phase_scope scope(profile.get(), PhaseMigrate);
+                migrateParticles(particles, tempvec);
+            }
+
+            // Periodically erase inactive particles
+            if (i % N == 0) {
+                phase_scope scope(profile.get(), PhaseErase);
+                std::erase_if(particles, [](const Particle& p) { return p.active != Active; });
+            }
+        }
+
+        #ifdef DEBUG
+        if (particles.size() > 3000) exit(1);
+        #endif
+
+        {
+            phase_scope scope(profile.get(), PhaseOutput);
+            // Writes particle positions to "particle-positions.txt"
+            for (const auto& particle : particles) {
+                if (particle.active != Active) continue;
+                #ifdef DEBUG
+                positionFile << particle.label << " " << particle.position[0] << " " << particle.position[1];
+                if (particle.wrapX) positionFile << "  (Wrapped-X)";
+                if (particle.wrapY) positionFile << "  (Wrapped-Y)";
+                positionFile << "\n";
+                #endif
+            }
+
+            if (!checkpointPath.empty() && ((checkpointEvery > 0 && (i + 1) % checkpointEvery == 0) || i + 1 == steps)) {
+                state.step = static_cast<uint64_t>(i + 1);
+                writeCheckpoint(checkpointPath, particles, state);
+            }
+        }
+        if (profile) profile->endStep(i);
+        stepLatency.record(std::chrono::steady_clock::now() - stepStart);
+    }
+
+    auto runtimeEnd = std::chrono::high_resolution_clock::now();
+    auto runtimeTotal = std::chrono::duration_cast<std::chrono::milliseconds>(runtimeEnd - runtimeStart).count();
+
+    std::cout << "Simulation Runtime: " << runtimeTotal << " ms\n";
+    stepLatency.report(std::cout, "Step");
+    if (profile) {
+        profile->reportLatency(std::cout);
+        profile->close();
+    }
+
+    // Close "particle-positions.txt"
+    positionFile.close();
+
+    return 0;
+}
@@ -0,0 +1,305 @@
+// Interacting particles: velocity-Verlet with short-range pair forces from a
+// cell list. Wrapped particles stay in place (the unordered mode of v20), so
+// particle indices are stable from step to step. Starting positions are
+// random, so Lennard-Jones is only stable at low density or small epsilon.
+//
+// Forces come from a Verlet neighbour list with the given skin, or straight
+// from the cell list every step with --skin 0. --force gravity replaces the
+// short-range forces with a Barnes-Hut tree walk, --force mesh with a
+// periodic particle-mesh solve of the same interaction. --check-tree 1
+// compares the tree's starting forces with the direct O(N^2) sum; most of
+// the error at the defaults comes from nodes across the periodic seam, which
+// a smaller --seam-size opens further (see tree_params).
+//
+// Usage: particle-sim-v21+forces [--particles 10000] [--steps 1000] [--threads T]
+//                                [--force soft|lj|gravity|mesh] [--epsilon 0.001] [--sigma 0.01] [--cutoff 0.025]
+//                                [--skin 0.01] [--G 1e-5] [--theta 0.5] [--softening 0.01]
+//                                [--seam-size 0.0625] [--check-tree 0|1]
+//                                [--grid 128] [--assignment cic|tsc]
+//                                [--reorder K] [--reorder-degradation f] [--curve hilbert|morton]
+//                                [--trajectory file] [--trajectory-every 100] [--trajectory-velocities 0|1]
+//                                [--trajectory-buffers 4]  (2 to 1024)
+//                                [--profile file.csv|file.json] [--profile-every 100] [--profile-counters 0|1]
+//                                [--trace file.json] [--trace-every 10]
+//                                [--thermostat none|langevin] [--gamma 1] [--kT 0.001]
+//                                [--seed 1691169547]
+//
+// --reorder sorts the particles along a space-filling curve every K steps,
+// --reorder-degradation when their locality has got f times worse.
+// --profile times each phase of the step on the main thread (see
+// phase_profile.h); it needs a build with -DUSE_PROFILE. Step latency
+// percentiles are always reported. --trace writes a Chrome trace of every
+// K-th step with each pool thread's share of the drift and kick.
+// --thermostat langevin replaces velocity Verlet with BAOAB Langevin
+// dynamics (see langevin.h) at temperature kT with friction gamma; the
+// noise only depends on the seed, the step and the particle id, so runs
+// are reproducible for any thread count.
+// --seed keys every random number of the run: the starting positions and
+// velocities and the Langevin noise.
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <memory>
+#include <algorithm>
+#include <cmath>
+#include "particle.h"
+#include "thread_pool.h"
+#include "cell_list.h"
+#include "neighbour_list.h"
+#include "barnes_hut.h"
+#include "particle_mesh.h"
+#include "reorder.h"
+#include "async_writer.h"
+#include "phase_profile.h"
+#include "latency_histogram.h"
+#include "trace_recorder.h"
+#include "parallel_init.h"
+#include "langevin.h"
+
+// Total kinetic energy of the active particles (unit mass)
+double kineticEnergy(const particle_vector& particles) {
+    double energy = 0.0;
+    for (const auto& p : particles) {
+        if (p.active != Active) continue;
+        energy += 0.5 * (p.velocity[0] * p.velocity[0] + p.velocity[1] * p.velocity[1]);
+    }
+    return energy;
+}
+
+int main(int argc, char** argv) {
+    size_t nparticles = 10000;
+    int steps = 1000;
+    uint64_t seed = 1691169547;
+    size_t threads = std::thread::hardware_concurrency();
+    force_params params;
+    bool cutoffSet = false;
+    double skin = 0.01;
+    bool gravity = false, mesh = false;
+    bool checkTree = false;
+    tree_params treeParams;
+    pm_params meshParams;
+    reorder_policy reorder;
+    std::string trajectoryPath;
+    int trajectoryEvery = 100;
+    bool trajectoryVelocities = false;
+    size_t trajectoryBuffers = 4;
+    std::string profilePath;
+    int profileEvery = 100;
+    bool profileCounters = false;
+    std::string tracePath;
+    int traceEvery = 10;
+    bool langevin = false;
+    langevin_params langevinParams;
+
+    for (int a = 1; a < argc; ++a) {
+        std::string arg = argv[a];
+        if (a + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << "\n";
+            exit(1);
+        }
+        std::string value = argv[++a];
+        if (arg == "--particles") nparticles = std::stoul(value);
+        else if (arg == "--steps") steps = std::stoi(value);
+        else if (arg == "--threads") threads = std::stoul(value);
+        else if (arg == "--force" && value == "gravity") gravity = true;
+        else if (arg == "--force" && value == "mesh") mesh = true;
+        else if (arg == "--force") params.kind = (value == "lj") ? force_params::LennardJones : force_params::SoftSphere;
+        else if (arg == "--epsilon") params.epsilon = std::stod(value);
+        else if (arg == "--sigma") params.sigma = std::stod(value);
+        else if (arg == "--cutoff") { params.cutoff = std::stod(value); cutoffSet = true; }
+        else if (arg == "--skin") skin = std::stod(value);
+        else if (arg == "--G") treeParams.G = meshParams.G = std::stod(value);
+        else if (arg == "--theta") treeParams.theta = std::stod(value);
+        else if (arg == "--softening") treeParams.softening = std::stod(value);
+        else if (arg == "--seam-size") treeParams.seamSize = std::stod(value);
+        else if (arg == "--check-tree") checkTree = (value == "1");
+        else if (arg == "--grid") meshParams.grid = std::stoul(value);
+        else if (arg == "--assignment") meshParams.assignment = (value == "tsc") ? pm_params::TSC : pm_params::CIC;
+        else if (arg == "--reorder") reorder.interval = std::stoi(value);
+        else if (arg == "--reorder-degradation") reorder.degradation = std::stod(value);
+        else if (arg == "--curve") reorder.curve = (value == "morton") ? Morton : Hilbert;
+        else if (arg == "--trajectory") trajectoryPath = value;
+        else if (arg == "--trajectory-every") trajectoryEvery = std::stoi(value);
+        else if (arg == "--trajectory-velocities") trajectoryVelocities = (value == "1");
+        else if (arg == "--trajectory-buffers") trajectoryBuffers = std::clamp<size_t>(std::stoul(value), 2, 1024);
+        else if (arg == "--profile") profilePath = value;
+        else if (arg == "--profile-every") profileEvery = std::stoi(value);
+        else if (arg == "--profile-counters") profileCounters = (value == "1");
+        else if (arg == "--trace") tracePath = value;
+        else if (arg == "--trace-every") traceEvery = std::stoi(value);
+        else if (arg == "--thermostat") langevin = (value == "langevin");
+        else if (arg == "--gamma") langevinParams.gamma = std::stod(value);
+        else if (arg == "--kT") langevinParams.kT = std::stod(value);
+        else if (arg == "--seed") seed = std::stoull(value);
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--particles n] [--steps n] [--threads n]"
+                      << " [--force soft|lj|gravity|mesh] [--epsilon e] [--sigma s] [--cutoff rc] [--skin s]"
+                      << " [--G g] [--theta t] [--softening s] [--seam-size s] [--check-tree 0|1] [--grid m] [--assignment cic|tsc]"
+                      << " [--reorder K] [--reorder-degradation f] [--curve hilbert|morton]"
+                      << " [--trajectory file] [--trajectory-every n] [--trajectory-velocities 0|1]"
+                      << " [--trajectory-buffers n] [--profile file] [--profile-every n] [--profile-counters 0|1]"
+                      << " [--trace file] [--trace-every K]"
+                      << " [--thermostat none|langevin] [--gamma g] [--kT t] [--seed s]\n";
+            exit(1);
+        }
+    }
+    // Conventional Lennard-Jones cutoff unless one was given
+    if (params.kind == force_params::LennardJones && !cutoffSet) params.cutoff = 2.5 * params.sigma;
+
+    thread_pool pool(threads);
+    langevinParams.seed = seed;
+
+    // Counter-based: the same particles for any thread count
+    particle_vector particles;
+    initParticlesParallel(particles, nparticles, seed, pool);
+
+    cell_list cells;
+    neighbour_list neighbours(skin);
+    barnes_hut tree;
+    particle_mesh grid;
+    auto forces = [&] {
+        if (gravity) return computeGravity(particles, treeParams, tree, pool);
+        if (mesh) return computeMeshGravity(particles, meshParams, grid, pool);
+        if (skin > 0) return computeForces(particles, params, neighbours, cells, pool);
+        return computeForces(particles, params, cells, pool);
+    };
+
+    // Time step
+    double dt = 0.01;
+
+    // Forces at the starting positions, so the first drift uses them
+    double potential = forces();
+    for (auto& p : particles) {
+        p.acceleration[0] = p.accNext[0];
+        p.acceleration[1] = p.accNext[1];
+    }
+    double startEnergy = kineticEnergy(particles) + potential;
+
+    if (gravity && checkTree) {
+        // Accuracy of the tree walk against the exact sum it approximates
+        particle_vector direct = particles;
+        double directPotential = computeGravityDirect(direct, treeParams, pool);
+        double errorSum = 0.0, normSum = 0.0, worst = 0.0;
+        for (size_t p = 0; p < particles.size(); ++p) {
+            if (particles[p].active != Active) continue;
+            double dx = particles[p].accNext[0] - direct[p].accNext[0];
+            double dy = particles[p].accNext[1] - direct[p].accNext[1];
+            double norm2 = direct[p].accNext[0] * direct[p].accNext[0] + direct[p].accNext[1] * direct[p].accNext[1];
+            errorSum += dx * dx + dy * dy;
+            normSum += norm2;
+            if (norm2 > 0) worst = std::max(worst, std::sqrt((dx * dx + dy * dy) / norm2));
+        }
+        std::cout << "Tree vs direct sum: rms force error " << std::sqrt(errorSum / normSum) << ", worst particle " << worst
+                  << ", potential " << potential << " vs " << directPotential << "\n";
+    }
+
+    // Snapshots are written by a background thread
+    std::unique_ptr<async_trajectory_writer> trajectory;
+    if (!trajectoryPath.empty()) {
+        uint32_t fields = TrajectoryFlags | (trajectoryVelocities ? static_cast<uint32_t>(TrajectoryVelocities) : 0u);
+        trajectory = std::make_unique<async_trajectory_writer>(trajectoryPath, fields, dt, trajectoryEvery, trajectoryBuffers);
+    }
+
+    std::unique_ptr<phase_profiler> profile;
+    if (!profilePath.empty()) {
+        if (!phase_profiler::enabled) std::cerr << "Built without USE_PROFILE, --profile is ignored\n";
+        profile = std::make_unique<phase_profiler>(profilePath, profileEvery, profileCounters);
+        if (profileCounters && phase_profiler::enabled && !profile->countersEnabled()) {
+            std::cerr << "Hardware counters are not available, recording time only\n";
+        }
+    }
+
+    std::unique_ptr<trace_recorder> trace;
+    if (!tracePath.empty()) trace = std::make_unique<trace_recorder>(pool.size(), 1 << 16, traceEvery);
+
+    // Starting the runtime clock
+    auto runtimeStart = std::chrono::high_resolution_clock::now();
+
+    size_t reorders = 0;
+    latency_histogram stepLatency;
+    for (int i = 0; i < steps; ++i) {
+        auto stepStart = std::chrono::steady_clock::now();
+        if (trace) trace->beginStep(i);
+        {
+            phase_scope scope(profile.get(), PhaseReorder);
+            trace_scope traced(trace.get(), 0, PhaseReorder);
+            if (reorderParticles(particles, i, reorder, pool)) {
+                neighbours.invalidate(); // Holds container indices
+                reorders++;
+            }
+        }
+
+        {
+            phase_scope scope(profile.get(), PhaseIntegrate);
+            pool.parallel_for(particles.size(), [&](size_t t, size_t begin, size_t end) {
+                trace_scope traced(trace.get(), t, PhaseIntegrate);
+                if (langevin) {
+                    langevinDriftRange(particles, begin, end, dt, static_cast<uint32_t>(i), langevinParams);
+                    return;
+                }
+                for (size_t p = begin; p < end; ++p) {
+                    if (particles[p].active == Active) driftParticle(particles[p], dt);
+                }
+            });
+        }
+
+        {
+            phase_scope scope(profile.get(), PhaseForces);
+            trace_scope traced(trace.get(), 0, PhaseForces);
+            potential = forces();
+        }
+
+        {
+            phase_scope scope(profile.get(), PhaseIntegrate);
+            pool.parallel_for(particles.size(), [&](size_t t, size_t begin, size_t end) {
+                trace_scope traced(trace.get(), t, PhaseIntegrate);
+                for (size_t p = begin; p < end; ++p) {
+                    if (particles[p].active != Active) continue;
+                    if (langevin) {
+                        langevinKick(particles[p], dt);
+                    } else {
+                        kickParticle(particles[p], dt);
+                    }
+                }
+            });
+        }
+
+        if (trajectory) {
+            phase_scope scope(profile.get(), PhaseOutput);
+            trace_scope traced(trace.get(), 0, PhaseOutput);
+            trajectory->capture(i, particles);
+        }
+        if (profile) profile->endStep(i);
+        stepLatency.record(std::chrono::steady_clock::now() - stepStart);
+    }
+
+    auto runtimeEnd = std::chrono::high_resolution_clock::now();
+    auto runtimeTotal = std::chrono::duration_cast<std::chrono::milliseconds>(runtimeEnd - runtimeStart).count();
+
+    if (profile) profile->close();
+    if (trace) {
+        trace->write(tracePath);
+        if (trace->dropped() > 0) std::cout << "Trace events dropped: " << trace->dropped() << "\n";
+    }
+    if (trajectory) {
+        trajectory->close();
+        std::cout << "Trajectory frames: " << trajectory->frames() << ", writer stalls: " << trajectory->stalls() << "\n";
+    }
+    double endEnergy = kineticEnergy(particles) + potential;
+    std::cout << "Simulation Runtime: " << runtimeTotal << " ms on " << pool.size() << " threads\n";
+    std::cout << "Total energy: " << startEnergy << " -> " << endEnergy << "\n";
+    if (langevin) {
+        // Unit mass in 2D: kT = kinetic energy per particle at equilibrium
+        std::cout << "Kinetic temperature: " << kineticEnergy(particles) / nparticles << " (target " << langevinParams.kT << ")\n";
+    }
+    stepLatency.report(std::cout, "Step");
+    if (profile) profile->reportLatency(std::cout);
+    if (reorders > 0) std::cout << "Reorders: " << reorders << "\n";
+    if (skin > 0 && !gravity && !mesh) std::cout << "Neighbour list builds: " << neighbours.builds << "\n";
+
+    return 0;
+}
@@ -0,0 +1,118 @@
+// Interacting particles on a grid of subdomains. Instead of wrapping
+// particles and re-appending them to one container, every subdomain owns
+// its particles and a worker thread, hands leavers to the domain they
+// entered and sends halo copies to its neighbours for the force pass.
+//
+// Usage: particle-sim-v22+domains [--particles 10000] [--steps 1000] [--domains 2x2]
+//                                 [--force soft|lj] [--epsilon 0.001] [--sigma 0.01] [--cutoff 0.025]
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <chrono>
+#include <thread>
+#include "particle.h"
+#include "thread_pool.h"
+#include "cell_list.h"
+#include "domain_decomposition.h"
+#include "parallel_init.h"
+
+// Total kinetic plus potential energy of the particles (unit mass)
+double totalEnergy(particle_vector& particles, const force_params& params) {
+    thread_pool serial(1);
+    cell_list cells;
+    particle_vector scratch = particles; // computeForces() overwrites accNext
+    double energy = computeForces(scratch, params, cells, serial);
+    for (const auto& p : particles) {
+        energy += 0.5 * (p.velocity[0] * p.velocity[0] + p.velocity[1] * p.velocity[1]);
+    }
+    return energy;
+}
+
+int main(int argc, char** argv) {
+    size_t nparticles = 10000;
+    int steps = 1000;
+    int nx = 2, ny = 2;
+    force_params params;
+    bool cutoffSet = false;
+
+    for (int a = 1; a < argc; ++a) {
+        std::string arg = argv[a];
+        if (a + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << "\n";
+            exit(1);
+        }
+        std::string value = argv[++a];
+        if (arg == "--particles") nparticles = std::stoul(value);
+        else if (arg == "--steps") steps = std::stoi(value);
+        else if (arg == "--domains") {
+            size_t x = value.find('x');
+            nx = std::stoi(value.substr(0, x));
+            ny = (x == std::string::npos) ? nx : std::stoi(value.substr(x + 1));
+        }
+        else if (arg == "--force") params.kind = (value == "lj") ? force_params::LennardJones : force_params::SoftSphere;
+        else if (arg == "--epsilon") params.epsilon = std::stod(value);
+        else if (arg == "--sigma") params.sigma = std::stod(value);
+        else if (arg == "--cutoff") { params.cutoff = std::stod(value); cutoffSet = true; }
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--particles n] [--steps n] [--domains NXxNY]"
+                      << " [--force soft|lj] [--epsilon e] [--sigma s] [--cutoff rc]\n";
+            exit(1);
+        }
+    }
+    // Conventional Lennard-Jones cutoff unless one was given
+    if (params.kind == force_params::LennardJones && !cutoffSet) params.cutoff = 2.5 * params.sigma;
+
+    if (nx < 1 || ny < 1) {
+        std::cerr << "Domain grid must be at least 1x1\n";
+        exit(1);
+    }
+    domain_decomposition domains(nx, ny);
+    if (params.range() > domains.minWidth()) {
+        std::cerr << "Subdomains must be at least the force range (" << params.range() << ") wide\n";
+        exit(1);
+    }
+
+    // Same particles as v21
+    particle_vector particles;
+    {
+        thread_pool pool(std::thread::hardware_concurrency());
+        initParticlesParallel(particles, nparticles, 1691169547, pool);
+    }
+    double startEnergy = totalEnergy(particles, params);
+
+    // Forces at the starting positions, so the first drift uses them
+    {
+        thread_pool serial(1);
+        cell_list cells;
+        computeForces(particles, params, cells, serial);
+        for (auto& p : particles) {
+            p.acceleration[0] = p.accNext[0];
+            p.acceleration[1] = p.accNext[1];
+        }
+    }
+    domains.distribute(particles);
+
+    // Time step
+    double dt = 0.01;
+
+    // Starting the runtime clock
+    auto runtimeStart = std::chrono::high_resolution_clock::now();
+
+    size_t migrated = 0;
+    for (int i = 0; i < steps; ++i) {
+        migrated += domains.step(dt, params);
+    }
+
+    auto runtimeEnd = std::chrono::high_resolution_clock::now();
+    auto runtimeTotal = std::chrono::duration_cast<std::chrono::milliseconds>(runtimeEnd - runtimeStart).count();
+
+    domains.gather(particles);
+    double endEnergy = totalEnergy(particles, params);
+    std::cout << "Simulation Runtime: " << runtimeTotal << " ms on " << domains.size() << " domains\n";
+    std::cout << "Particles: " << particles.size() << ", migrations: " << migrated << "\n";
+    std::cout << "Total energy: " << startEnergy << " -> " << endEnergy << "\n";
+
+    return 0;
+}
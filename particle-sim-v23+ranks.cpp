@@ -0,0 +1,102 @@
+// Free particles spread over ranks that each own an x-slab of the periodic
+// box, exchanging migrating particles every step. Without USE_MPI the
+// ranks are forked processes talking through shared memory; with USE_MPI
+// (build with mpicxx) they are the MPI processes and --ranks is ignored.
+//
+// Usage: particle-sim-v23+ranks [--ranks 2] [--particles 10000] [--steps 10000]
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <chrono>
+#include "particle.h"
+#include "transport.h"
+#include "slab.h"
+#include "parallel_init.h"
+
+int main(int argc, char** argv) {
+#ifdef USE_MPI
+    MPI_Init(&argc, &argv);
+#endif
+    int ranks = 2;
+    size_t nparticles = 10000;
+    int steps = 10000;
+
+    for (int a = 1; a < argc; ++a) {
+        std::string arg = argv[a];
+        if (a + 1 >= argc) {
+            std::cerr << "Missing value for " << arg << "\n";
+            exit(1);
+        }
+        std::string value = argv[++a];
+        if (arg == "--ranks") ranks = std::stoi(value);
+        else if (arg == "--particles") nparticles = std::stoul(value);
+        else if (arg == "--steps") steps = std::stoi(value);
+        else {
+            std::cerr << "Usage: " << argv[0] << " [--ranks n] [--particles n] [--steps n]\n";
+            exit(1);
+        }
+    }
+
+#ifdef USE_MPI
+    mpi_transport transport;
+    (void)ranks; // mpirun decides the number of ranks
+#else
+    if (ranks < 1) {
+        std::cerr << "Need at least one rank\n";
+        exit(1);
+    }
+    // A mailbox never holds more than every particle
+    loopback_transport transport(ranks, nparticles);
+    transport.launch();
+#endif
+
+    // Every rank makes the same particles and keeps the ones in its slab
+    particle_vector all;
+    {
+        thread_pool serial(1);
+        initParticlesParallel(all, nparticles, 1691169547, serial);
+    }
+    slab s(transport.rank(), transport.size());
+    std::vector<Particle> particles;
+    for (const auto& p : all) {
+        if (s.contains(p.position[0])) particles.push_back(p);
+    }
+    all.clear();
+
+    // Time step
+    double dt = 0.01;
+
+    // Starting the runtime clock
+    auto runtimeStart = std::chrono::high_resolution_clock::now();
+
+    size_t sent = 0;
+    for (int i = 0; i < steps; ++i) {
+        sent += moveParticlesSlab(particles, dt, s, transport);
+    }
+
+    auto runtimeEnd = std::chrono::high_resolution_clock::now();
+    auto runtimeTotal = std::chrono::duration_cast<std::chrono::milliseconds>(runtimeEnd - runtimeStart).count();
+
+    // Totals over all ranks
+    double checksum = 0.0;
+    for (const auto& p : particles) checksum += p.position[0] + p.position[1];
+    double count = transport.sum(static_cast<double>(particles.size()));
+    double migrations = transport.sum(static_cast<double>(sent));
+    checksum = transport.sum(checksum);
+
+    if (transport.rank() == 0) {
+        std::cout << "Simulation Runtime: " << runtimeTotal << " ms on " << transport.size() << " ranks\n";
+        std::cout << "Particles: " << count << ", migrations: " << migrations << "\n";
+        std::cout.precision(12);
+        std::cout << "Position checksum: " << checksum << "\n";
+    }
+
+#ifdef USE_MPI
+    MPI_Finalize();
+#else
+    transport.shutdown();
+#endif
+    return 0;
+}
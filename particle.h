@@ -0,0 +1,153 @@
+#ifndef PARTICLE_H
+#define PARTICLE_H
+#include <cstdlib>
+#include <cstdint>
+#include <random>
+
+enum ActiveState {
+    Active,
+    Removing,
+    Removed
+};
+
+struct Particle {
+    char label;             // Unique alphabetical label for the particle
+    uint32_t id;            // Index at creation, kept through moves, sorts and migration; fills padding after label
+    double position[2];     // Position (x, y)
+    double velocity[2];     // Velocity (vx, vy)
+    double acceleration[2]; // Acceleration (ax, ay)
+    double accNext[2];      // Next acceleration (ax', ay')
+    bool wrapX;             // Flag to indicate if particle has wrapped around in X axis
+    bool wrapY;             // Flag to indicate if particle has wrapped around in Y axis
+    ActiveState active;     // Flag to indicate if the particle has crossed a boundary and moved to a new vector
+};
+
+inline double genRN(double min, double max) {
+    return min + static_cast<double>(rand()) / RAND_MAX * (max - min);
+}
+
+// Engine for sims that checkpoint: unlike rand() its whole state can be
+// saved and restored, so a restarted run draws the same numbers
+using particle_rng = std::mt19937_64;
+
+// Uniform in [min, max) from the top 53 bits of one draw, the same on every
+// standard library
+inline double genRN(particle_rng& rng, double min, double max) {
+    return min + static_cast<double>(rng() >> 11) * 0x1.0p-53 * (max - min);
+}
+
+// Create n particles at random positions with random velocities drawn from
+// random(min, max)
+template <typename Container, typename Random>
+void initParticles(Container& particles, size_t n, Random&& random) {
+    for (size_t i = 0; i < n; i++) {
+        Particle particle;
+        particle.label = 0;
+        particle.id = static_cast<uint32_t>(i);
+        particle.position[0] = random(0.0, 1.0);
+        particle.position[1] = random(0.0, 1.0);
+        particle.velocity[0] = random(-0.1, 0.1);
+        particle.velocity[1] = random(-0.1, 0.1);
+        particle.acceleration[0] = 0.0;
+        particle.acceleration[1] = 0.0;
+        particle.accNext[0] = 0.0;
+        particle.accNext[1] = 0.0;
+        particle.wrapX = false;
+        particle.wrapY = false;
+        particle.active = Active; // Initialised to Active
+        particles.push_back(particle);
+    }
+}
+
+// Same, drawing from rand()
+template <typename Container>
+void initParticles(Container& particles, size_t n) {
+    initParticles(particles, n, [](double min, double max) { return genRN(min, max); });
+}
+
+// Same, drawing from rng
+template <typename Container>
+void initParticles(Container& particles, size_t n, particle_rng& rng) {
+    initParticles(particles, n, [&rng](double min, double max) { return genRN(rng, min, max); });
+}
+
+// Apply periodic boundary conditions, setting the wrap flags of each axis
+// the particle crossed
+inline void wrapParticle(Particle& particle) {
+    if (particle.position[0] < 0) {
+        particle.position[0] += 1; // Apply periodic boundary conditions in X direction
+        particle.wrapX = true;
+    }
+    if (particle.position[0] >= 1) {
+        particle.position[0] -= 1;
+        particle.wrapX = true;
+    }
+    if (particle.position[1] < 0) {
+        particle.position[1] += 1; // Apply periodic boundary conditions in Y direction
+        particle.wrapY = true;
+    }
+    if (particle.position[1] >= 1) {
+        particle.position[1] -= 1;
+        particle.wrapY = true;
+    }
+}
+
+// First half of the velocity-Verlet update: advance the position with the
+// current acceleration and apply periodic boundary conditions
+inline void driftParticle(Particle& particle, double dt) {
+    particle.wrapX = false; // Clear wrapping flags at the beginning of each iteration
+    particle.wrapY = false;
+
+    // Update position
+    particle.position[0] += particle.velocity[0] * dt + 0.5 * particle.acceleration[0] * dt * dt;
+    particle.position[1] += particle.velocity[1] * dt + 0.5 * particle.acceleration[1] * dt * dt;
+
+    wrapParticle(particle);
+}
+
+// Second half of the velocity-Verlet update: advance the velocity with the
+// average of the current and next acceleration, then step the acceleration
+inline void kickParticle(Particle& particle, double dt) {
+    particle.velocity[0] += 0.5 * (particle.acceleration[0] + particle.accNext[0]) * dt; // Update velocity
+    particle.velocity[1] += 0.5 * (particle.acceleration[1] + particle.accNext[1]) * dt;
+
+    particle.acceleration[0] = particle.accNext[0]; // Update acceleration
+    particle.acceleration[1] = particle.accNext[1];
+}
+
+// Velocity-Verlet update of a single particle with periodic boundary conditions.
+// accNext is used as it stands, so forces must already be in it.
+inline void moveParticle(Particle& particle, double dt) {
+    driftParticle(particle, dt);
+    kickParticle(particle, dt);
+}
+
+// Move every active particle in any container that supports range-for
+template <typename Container>
+void moveParticles(Container& particles, double dt) {
+    for (auto& particle : particles) {
+        if (particle.active != Active) continue;
+        moveParticle(particle, dt);
+    }
+}
+
+// Copy particles that wrapped this step to tempvec, mark the originals as
+// Removed and append the copies to the end of the container.
+// Returns the number of particles that were migrated.
+template <typename Container, typename Buffer>
+size_t migrateParticles(Container& particles, Buffer& tempvec) {
+    tempvec.clear();
+    for (auto& particle : particles) {
+        if (particle.active != Active) continue;
+        if (particle.wrapX || particle.wrapY) {
+            tempvec.push_back(particle);
+            particle.active = Removed;
+        }
+    }
+    if (!tempvec.empty()) {
+        particles.insert(particles.end(), tempvec.begin(), tempvec.end());
+    }
+    return tempvec.size();
+}
+
+#endif
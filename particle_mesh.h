@@ -0,0 +1,223 @@
+#ifndef PARTICLE_MESH_H
+#define PARTICLE_MESH_H
+#include <cstddef> //needed for size_t
+#include <cmath>
+#include <complex>
+#include <vector>
+#include <algorithm>
+#include "particle.h"
+#include "thread_pool.h"
+
+// Particle-mesh solver for the same 1/r^2 interaction as barnes_hut.h,
+// summed over all periodic images of the unit box.
+struct pm_params {
+    enum Assignment {
+        CIC, // Cloud-in-cell: 2x2 grid points per particle
+        TSC  // Triangular-shaped cloud: 3x3 grid points per particle
+    };
+    size_t grid = 128;           // Grid points per side, rounded up to a power of two
+    Assignment assignment = CIC;
+    double G = 1e-5;             // Coupling strength, as in tree_params
+    // Gaussian smoothing scale of the mesh force, in grid cells. The 1/r^2
+    // force has no natural cut-off in k, so without it the truncated Fourier
+    // sum rings at every distance; beyond a few smoothing lengths the
+    // smoothed force matches the unsmoothed one.
+    double smoothing = 1.5;
+};
+
+// In-place iterative radix-2 FFT of n complex values, n a power of two.
+// Neither direction is normalised.
+inline void fft(std::complex<double>* data, size_t n, bool inverse) {
+    for (size_t i = 1, j = 0; i < n; ++i) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) j ^= bit;
+        j ^= bit;
+        if (i < j) std::swap(data[i], data[j]);
+    }
+    for (size_t len = 2; len <= n; len <<= 1) {
+        double angle = (inverse ? 2.0 : -2.0) * M_PI / len;
+        std::complex<double> step(std::cos(angle), std::sin(angle));
+        for (size_t i = 0; i < n; i += len) {
+            std::complex<double> w(1.0, 0.0);
+            for (size_t k = 0; k < len / 2; ++k) {
+                std::complex<double> a = data[i + k];
+                std::complex<double> b = data[i + k + len / 2] * w;
+                data[i + k] = a + b;
+                data[i + k + len / 2] = a - b;
+                w *= step;
+            }
+        }
+    }
+}
+
+// Grid points and weights a particle at coordinate u (in grid units) is
+// spread over along one axis. Returns the number of points used.
+inline int assignmentStencil(double u, size_t m, pm_params::Assignment assignment, size_t index[3], double weight[3]) {
+    if (assignment == pm_params::CIC) {
+        double base = std::floor(u);
+        double f = u - base;
+        size_t i = static_cast<size_t>(base) % m;
+        index[0] = i;
+        index[1] = (i + 1) % m;
+        weight[0] = 1.0 - f;
+        weight[1] = f;
+        return 2;
+    }
+    double nearest = std::floor(u + 0.5);
+    double d = u - nearest;
+    size_t i = static_cast<size_t>(nearest) % m;
+    index[0] = (i + m - 1) % m;
+    index[1] = i;
+    index[2] = (i + 1) % m;
+    weight[0] = 0.5 * (0.5 - d) * (0.5 - d);
+    weight[1] = 0.75 - d * d;
+    weight[2] = 0.5 * (0.5 + d) * (0.5 + d);
+    return 3;
+}
+
+// Work grids for the particle-mesh solve, kept between steps
+class particle_mesh {
+public:
+    size_t m = 0;                                  // Grid points per side
+    std::vector<std::complex<double>> rho;         // Mass, then its transform
+    std::vector<std::complex<double>> phi, gx, gy; // Potential and acceleration
+    std::vector<std::vector<double>> partial;      // Per-thread deposit grids
+
+    // Size the grids for the requested resolution and thread count
+    void prepare(size_t grid, size_t threads) {
+        if (grid == requested && partial.size() == threads) return;
+        requested = grid;
+        size_t size = 1;
+        while (size < grid) size <<= 1;
+        m = size;
+        rho.resize(m * m);
+        phi.resize(m * m);
+        gx.resize(m * m);
+        gy.resize(m * m);
+        partial.resize(threads);
+        for (auto& p : partial) p.resize(m * m);
+    }
+
+    // Transform the grid in place: every row, then every column
+    void fft2(std::vector<std::complex<double>>& grid, bool inverse, thread_pool& pool) {
+        pool.parallel_for(m, [&](size_t, size_t begin, size_t end) {
+            for (size_t r = begin; r < end; ++r) fft(&grid[r * m], m, inverse);
+        });
+        pool.parallel_for(m, [&](size_t, size_t begin, size_t end) {
+            std::vector<std::complex<double>> column(m);
+            for (size_t c = begin; c < end; ++c) {
+                for (size_t r = 0; r < m; ++r) column[r] = grid[r * m + c];
+                fft(column.data(), m, inverse);
+                for (size_t r = 0; r < m; ++r) grid[r * m + c] = column[r];
+            }
+        });
+    }
+
+private:
+    size_t requested = 0;
+};
+
+// Fill accNext of every active particle with the periodic long-range
+// acceleration from a particle-mesh solve:
+//   1. deposit unit masses on the grid with CIC or TSC weights, each thread
+//      into its own grid, then sum the grids
+//   2. FFT, multiply by the Green's function of the 1/r potential
+//      (-2 pi G / |k|, mean density dropped) times the Gaussian smoothing
+//      exp(-k^2 rs^2), and take -ik for the gradient
+//   3. inverse FFT the potential and both acceleration components
+//   4. interpolate back to the particles with the same weights
+// Cost is O(N + M^2 log M). Returns the total potential energy, which
+// includes each particle's interaction with its own smoothed cloud.
+template <typename Container>
+double computeMeshGravity(Container& particles, const pm_params& params, particle_mesh& mesh, thread_pool& pool) {
+    mesh.prepare(params.grid, pool.size());
+    size_t m = mesh.m;
+    size_t cells = m * m;
+    size_t n = particles.size();
+
+    // 1. Deposit
+    pool.parallel_for(n, [&](size_t t, size_t begin, size_t end) {
+        std::vector<double>& grid = mesh.partial[t];
+        std::fill(grid.begin(), grid.end(), 0.0);
+        size_t ix[3], iy[3];
+        double wx[3], wy[3];
+        for (size_t i = begin; i < end; ++i) {
+            const Particle& p = particles[i];
+            if (p.active != Active) continue;
+            int nx = assignmentStencil(p.position[0] * m, m, params.assignment, ix, wx);
+            int ny = assignmentStencil(p.position[1] * m, m, params.assignment, iy, wy);
+            for (int b = 0; b < ny; ++b) {
+                for (int a = 0; a < nx; ++a) grid[iy[b] * m + ix[a]] += wy[b] * wx[a];
+            }
+        }
+    });
+    pool.parallel_for(cells, [&](size_t, size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            double mass = 0.0;
+            for (const auto& grid : mesh.partial) mass += grid[c];
+            mesh.rho[c] = mass;
+        }
+    });
+
+    // 2. Solve in k-space
+    double rs = params.smoothing / m;
+    double rs2 = rs * rs;
+    mesh.fft2(mesh.rho, false, pool);
+    pool.parallel_for(cells, [&](size_t, size_t begin, size_t end) {
+        for (size_t c = begin; c < end; ++c) {
+            size_t r = c / m, col = c % m;
+            // Signed wavenumbers; the Nyquist mode has no sign, so it gets
+            // no gradient
+            long sx = col < m / 2 ? static_cast<long>(col) : static_cast<long>(col) - static_cast<long>(m);
+            long sy = r < m / 2 ? static_cast<long>(r) : static_cast<long>(r) - static_cast<long>(m);
+            double kx = 2.0 * M_PI * sx, ky = 2.0 * M_PI * sy;
+            double k = std::sqrt(kx * kx + ky * ky);
+            double green = k > 0 ? -2.0 * M_PI * params.G / k * std::exp(-k * k * rs2) : 0.0;
+            std::complex<double> potential = green * mesh.rho[c];
+            const std::complex<double> i(0.0, 1.0);
+            mesh.phi[c] = potential;
+            mesh.gx[c] = (col == m / 2) ? 0.0 : -i * kx * potential;
+            mesh.gy[c] = (r == m / 2) ? 0.0 : -i * ky * potential;
+        }
+    });
+
+    // 3. Back to real space. The unit box has area 1, so the unnormalised
+    // inverse is the Fourier series itself.
+    mesh.fft2(mesh.phi, true, pool);
+    mesh.fft2(mesh.gx, true, pool);
+    mesh.fft2(mesh.gy, true, pool);
+
+    // 4. Interpolate
+    std::vector<double> energy(pool.size(), 0.0);
+    pool.parallel_for(n, [&](size_t t, size_t begin, size_t end) {
+        size_t ix[3], iy[3];
+        double wx[3], wy[3];
+        double localEnergy = 0.0;
+        for (size_t i = begin; i < end; ++i) {
+            Particle& p = particles[i];
+            if (p.active != Active) continue;
+            int nx = assignmentStencil(p.position[0] * m, m, params.assignment, ix, wx);
+            int ny = assignmentStencil(p.position[1] * m, m, params.assignment, iy, wy);
+            double ax = 0.0, ay = 0.0, potential = 0.0;
+            for (int b = 0; b < ny; ++b) {
+                for (int a = 0; a < nx; ++a) {
+                    size_t c = iy[b] * m + ix[a];
+                    double w = wy[b] * wx[a];
+                    ax += w * mesh.gx[c].real();
+                    ay += w * mesh.gy[c].real();
+                    potential += w * mesh.phi[c].real();
+                }
+            }
+            p.accNext[0] = ax;
+            p.accNext[1] = ay;
+            localEnergy += 0.5 * potential;
+        }
+        energy[t] = localEnergy;
+    });
+
+    double total = 0.0;
+    for (double e : energy) total += e;
+    return total;
+}
+
+#endif
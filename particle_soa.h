@@ -0,0 +1,324 @@
+#ifndef PARTICLE_SOA_H
+#define PARTICLE_SOA_H
+#include <cstddef> //needed for size_t
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <utility>
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#include "particle.h"
+
+// Layout of the packed state byte: bit 0 is wrapX, bit 1 is wrapY and
+// bits 2-3 hold the ActiveState
+const unsigned char StateWrapX = 1;
+const unsigned char StateWrapY = 2;
+const unsigned char StateActiveMask = 12;
+const int StateActiveShift = 2;
+
+inline unsigned char packState(bool wrapX, bool wrapY, ActiveState active) {
+    return static_cast<unsigned char>((wrapX ? StateWrapX : 0) | (wrapY ? StateWrapY : 0) | (active << StateActiveShift));
+}
+
+inline ActiveState stateActive(unsigned char state) {
+    return static_cast<ActiveState>((state & StateActiveMask) >> StateActiveShift);
+}
+
+// Structure-of-Arrays particle store. Every field of Particle lives in its
+// own cache line aligned array so the update loop only streams the data it
+// needs and can be vectorised.
+class particle_soa {
+public:
+    static const size_t alignment = 64;
+
+    double *x = nullptr, *y = nullptr;
+    double *vx = nullptr, *vy = nullptr;
+    double *ax = nullptr, *ay = nullptr;
+    double *axNext = nullptr, *ayNext = nullptr;
+    unsigned char *state = nullptr;
+
+    particle_soa() {}
+    explicit particle_soa(size_t n) { reserve(n); }
+    particle_soa(const particle_soa&) = delete;
+    particle_soa& operator=(const particle_soa&) = delete;
+    particle_soa(particle_soa&& other) noexcept { swap(other); }
+    particle_soa& operator=(particle_soa&& other) noexcept {
+        if (this != &other) {
+            release();
+            swap(other);
+        }
+        return *this;
+    }
+    ~particle_soa() { release(); }
+
+    size_t size() const { return sz; }
+    size_t capacity() const { return cap; }
+    bool empty() const { return sz == 0; }
+    void clear() { sz = 0; }
+
+    void reserve(size_t n) {
+        if (n <= cap) return;
+        // Round up so every array is a whole number of cache lines
+        size_t newCap = (n + 7) & ~static_cast<size_t>(7);
+        double **fields[8] = {&x, &y, &vx, &vy, &ax, &ay, &axNext, &ayNext};
+        for (double **field : fields) {
+            *field = static_cast<double *>(grow(*field, newCap * sizeof(double)));
+        }
+        state = static_cast<unsigned char *>(grow(state, (newCap + alignment - 1) & ~(alignment - 1)));
+        cap = newCap;
+    }
+
+    void push_back(const Particle& in) {
+        if (sz == cap) {
+            reserve(cap == 0 ? 8 : cap * 2);
+        }
+        set(sz, in);
+        ++sz;
+    }
+
+    // Set the size to n. Slots past the old size are left uninitialised for
+    // the caller to fill, so a parallel fill also does the first touch.
+    void resize(size_t n) {
+        reserve(n);
+        sz = n;
+    }
+
+    // Scatter a Particle into slot i
+    void set(size_t i, const Particle& in) {
+        x[i] = in.position[0];
+        y[i] = in.position[1];
+        vx[i] = in.velocity[0];
+        vy[i] = in.velocity[1];
+        ax[i] = in.acceleration[0];
+        ay[i] = in.acceleration[1];
+        axNext[i] = in.accNext[0];
+        ayNext[i] = in.accNext[1];
+        state[i] = packState(in.wrapX, in.wrapY, in.active);
+    }
+
+    // Gather slot i back into a Particle
+    Particle get(size_t i) const {
+        Particle out;
+        out.label = 0; // The SoA store keeps neither label nor id
+        out.id = 0;
+        out.position[0] = x[i];
+        out.position[1] = y[i];
+        out.velocity[0] = vx[i];
+        out.velocity[1] = vy[i];
+        out.acceleration[0] = ax[i];
+        out.acceleration[1] = ay[i];
+        out.accNext[0] = axNext[i];
+        out.accNext[1] = ayNext[i];
+        out.wrapX = state[i] & StateWrapX;
+        out.wrapY = state[i] & StateWrapY;
+        out.active = stateActive(state[i]);
+        return out;
+    }
+
+    // Remove every particle that is not Active, keeping the order of the rest
+    size_t erase_inactive() {
+        size_t out = 0;
+        for (size_t i = 0; i < sz; ++i) {
+            if (stateActive(state[i]) != Active) continue;
+            if (out != i) {
+                x[out] = x[i];
+                y[out] = y[i];
+                vx[out] = vx[i];
+                vy[out] = vy[i];
+                ax[out] = ax[i];
+                ay[out] = ay[i];
+                axNext[out] = axNext[i];
+                ayNext[out] = ayNext[i];
+                state[out] = state[i];
+            }
+            ++out;
+        }
+        size_t removed = sz - out;
+        sz = out;
+        return removed;
+    }
+
+    void swap(particle_soa& other) noexcept {
+        std::swap(x, other.x);
+        std::swap(y, other.y);
+        std::swap(vx, other.vx);
+        std::swap(vy, other.vy);
+        std::swap(ax, other.ax);
+        std::swap(ay, other.ay);
+        std::swap(axNext, other.axNext);
+        std::swap(ayNext, other.ayNext);
+        std::swap(state, other.state);
+        std::swap(sz, other.sz);
+        std::swap(cap, other.cap);
+    }
+
+private:
+    size_t sz = 0, cap = 0;
+
+    // Allocate a new aligned array of the given size in bytes and copy the
+    // live part of the old one across
+    template <typename U>
+    U *grow(U *old, size_t bytes) {
+        void *fresh = std::aligned_alloc(alignment, (bytes + alignment - 1) & ~(alignment - 1));
+        if (!fresh) throw std::bad_alloc();
+        if (old) {
+            memcpy(fresh, old, sz * sizeof(U));
+            std::free(old);
+        }
+        return static_cast<U *>(fresh);
+    }
+
+    void release() {
+        double *fields[8] = {x, y, vx, vy, ax, ay, axNext, ayNext};
+        for (double *field : fields) std::free(field);
+        std::free(state);
+        x = y = vx = vy = ax = ay = axNext = ayNext = nullptr;
+        state = nullptr;
+        sz = cap = 0;
+    }
+};
+
+// Branch-free update of particles [begin, end). Inactive particles are left
+// untouched, active ones get the same velocity-Verlet update and periodic
+// wrap as moveParticle() in particle.h.
+inline void moveParticlesScalar(particle_soa& p, size_t begin, size_t end, double dt) {
+    double *__restrict x = p.x, *__restrict y = p.y;
+    double *__restrict vx = p.vx, *__restrict vy = p.vy;
+    double *__restrict ax = p.ax, *__restrict ay = p.ay;
+    const double *__restrict axNext = p.axNext, *__restrict ayNext = p.ayNext;
+    unsigned char *__restrict state = p.state;
+    for (size_t i = begin; i < end; ++i) {
+        bool active = (state[i] & StateActiveMask) == 0;
+        double nx = x[i] + (vx[i] * dt + 0.5 * ax[i] * dt * dt);
+        double ny = y[i] + (vy[i] * dt + 0.5 * ay[i] * dt * dt);
+        bool loX = nx < 0;
+        nx += loX ? 1.0 : 0.0;
+        bool hiX = nx >= 1;
+        nx -= hiX ? 1.0 : 0.0;
+        bool loY = ny < 0;
+        ny += loY ? 1.0 : 0.0;
+        bool hiY = ny >= 1;
+        ny -= hiY ? 1.0 : 0.0;
+        double nvx = vx[i] + 0.5 * (ax[i] + axNext[i]) * dt;
+        double nvy = vy[i] + 0.5 * (ay[i] + ayNext[i]) * dt;
+        x[i] = active ? nx : x[i];
+        y[i] = active ? ny : y[i];
+        vx[i] = active ? nvx : vx[i];
+        vy[i] = active ? nvy : vy[i];
+        ax[i] = active ? axNext[i] : ax[i];
+        ay[i] = active ? ayNext[i] : ay[i];
+        unsigned char wrapped = static_cast<unsigned char>((loX | hiX) | ((loY | hiY) << 1));
+        state[i] = active ? static_cast<unsigned char>((state[i] & StateActiveMask) | wrapped) : state[i];
+    }
+}
+
+#if defined(__AVX512F__)
+inline void moveParticlesSimd(particle_soa& p, size_t& i, size_t end, double dt) {
+    const __m512d vdt = _mm512_set1_pd(dt);
+    const __m512d half = _mm512_set1_pd(0.5);
+    const __m512d zero = _mm512_setzero_pd();
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512i activeBits = _mm512_set1_epi64(StateActiveMask);
+    for (; i + 8 <= end; i += 8) {
+        __m512i s = _mm512_cvtepu8_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(p.state + i)));
+        __mmask8 active = _mm512_testn_epi64_mask(s, activeBits);
+        if (!active) continue;
+        __m512d x = _mm512_loadu_pd(p.x + i), y = _mm512_loadu_pd(p.y + i);
+        __m512d vx = _mm512_loadu_pd(p.vx + i), vy = _mm512_loadu_pd(p.vy + i);
+        __m512d ax = _mm512_loadu_pd(p.ax + i), ay = _mm512_loadu_pd(p.ay + i);
+        __m512d axn = _mm512_loadu_pd(p.axNext + i), ayn = _mm512_loadu_pd(p.ayNext + i);
+        // x + (vx*dt + 0.5*ax*dt*dt), same operation order as the scalar code
+        __m512d nx = _mm512_add_pd(x, _mm512_add_pd(_mm512_mul_pd(vx, vdt),
+                         _mm512_mul_pd(_mm512_mul_pd(_mm512_mul_pd(half, ax), vdt), vdt)));
+        __m512d ny = _mm512_add_pd(y, _mm512_add_pd(_mm512_mul_pd(vy, vdt),
+                         _mm512_mul_pd(_mm512_mul_pd(_mm512_mul_pd(half, ay), vdt), vdt)));
+        __mmask8 loX = _mm512_cmp_pd_mask(nx, zero, _CMP_LT_OQ);
+        nx = _mm512_mask_add_pd(nx, loX, nx, one);
+        __mmask8 hiX = _mm512_cmp_pd_mask(nx, one, _CMP_GE_OQ);
+        nx = _mm512_mask_sub_pd(nx, hiX, nx, one);
+        __mmask8 loY = _mm512_cmp_pd_mask(ny, zero, _CMP_LT_OQ);
+        ny = _mm512_mask_add_pd(ny, loY, ny, one);
+        __mmask8 hiY = _mm512_cmp_pd_mask(ny, one, _CMP_GE_OQ);
+        ny = _mm512_mask_sub_pd(ny, hiY, ny, one);
+        __m512d nvx = _mm512_add_pd(vx, _mm512_mul_pd(_mm512_mul_pd(half, _mm512_add_pd(ax, axn)), vdt));
+        __m512d nvy = _mm512_add_pd(vy, _mm512_mul_pd(_mm512_mul_pd(half, _mm512_add_pd(ay, ayn)), vdt));
+        _mm512_storeu_pd(p.x + i, _mm512_mask_blend_pd(active, x, nx));
+        _mm512_storeu_pd(p.y + i, _mm512_mask_blend_pd(active, y, ny));
+        _mm512_storeu_pd(p.vx + i, _mm512_mask_blend_pd(active, vx, nvx));
+        _mm512_storeu_pd(p.vy + i, _mm512_mask_blend_pd(active, vy, nvy));
+        _mm512_storeu_pd(p.ax + i, _mm512_mask_blend_pd(active, ax, axn));
+        _mm512_storeu_pd(p.ay + i, _mm512_mask_blend_pd(active, ay, ayn));
+        unsigned wrapX = loX | hiX, wrapY = loY | hiY;
+        for (int k = 0; k < 8; ++k) {
+            unsigned char old = p.state[i + k];
+            unsigned char updated = static_cast<unsigned char>((old & StateActiveMask) | ((wrapX >> k) & 1) | (((wrapY >> k) & 1) << 1));
+            p.state[i + k] = ((active >> k) & 1) ? updated : old;
+        }
+    }
+}
+#elif defined(__AVX2__)
+inline void moveParticlesSimd(particle_soa& p, size_t& i, size_t end, double dt) {
+    const __m256d vdt = _mm256_set1_pd(dt);
+    const __m256d half = _mm256_set1_pd(0.5);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256i activeBits = _mm256_set1_epi64x(StateActiveMask);
+    for (; i + 4 <= end; i += 4) {
+        int packed;
+        memcpy(&packed, p.state + i, sizeof(packed));
+        __m256i s = _mm256_cvtepu8_epi64(_mm_cvtsi32_si128(packed));
+        __m256d active = _mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(s, activeBits), _mm256_setzero_si256()));
+        int activeMask = _mm256_movemask_pd(active);
+        if (!activeMask) continue;
+        __m256d x = _mm256_loadu_pd(p.x + i), y = _mm256_loadu_pd(p.y + i);
+        __m256d vx = _mm256_loadu_pd(p.vx + i), vy = _mm256_loadu_pd(p.vy + i);
+        __m256d ax = _mm256_loadu_pd(p.ax + i), ay = _mm256_loadu_pd(p.ay + i);
+        __m256d axn = _mm256_loadu_pd(p.axNext + i), ayn = _mm256_loadu_pd(p.ayNext + i);
+        // x + (vx*dt + 0.5*ax*dt*dt), same operation order as the scalar code
+        __m256d nx = _mm256_add_pd(x, _mm256_add_pd(_mm256_mul_pd(vx, vdt),
+                         _mm256_mul_pd(_mm256_mul_pd(_mm256_mul_pd(half, ax), vdt), vdt)));
+        __m256d ny = _mm256_add_pd(y, _mm256_add_pd(_mm256_mul_pd(vy, vdt),
+                         _mm256_mul_pd(_mm256_mul_pd(_mm256_mul_pd(half, ay), vdt), vdt)));
+        __m256d loX = _mm256_cmp_pd(nx, zero, _CMP_LT_OQ);
+        nx = _mm256_add_pd(nx, _mm256_and_pd(loX, one));
+        __m256d hiX = _mm256_cmp_pd(nx, one, _CMP_GE_OQ);
+        nx = _mm256_sub_pd(nx, _mm256_and_pd(hiX, one));
+        __m256d loY = _mm256_cmp_pd(ny, zero, _CMP_LT_OQ);
+        ny = _mm256_add_pd(ny, _mm256_and_pd(loY, one));
+        __m256d hiY = _mm256_cmp_pd(ny, one, _CMP_GE_OQ);
+        ny = _mm256_sub_pd(ny, _mm256_and_pd(hiY, one));
+        __m256d nvx = _mm256_add_pd(vx, _mm256_mul_pd(_mm256_mul_pd(half, _mm256_add_pd(ax, axn)), vdt));
+        __m256d nvy = _mm256_add_pd(vy, _mm256_mul_pd(_mm256_mul_pd(half, _mm256_add_pd(ay, ayn)), vdt));
+        _mm256_storeu_pd(p.x + i, _mm256_blendv_pd(x, nx, active));
+        _mm256_storeu_pd(p.y + i, _mm256_blendv_pd(y, ny, active));
+        _mm256_storeu_pd(p.vx + i, _mm256_blendv_pd(vx, nvx, active));
+        _mm256_storeu_pd(p.vy + i, _mm256_blendv_pd(vy, nvy, active));
+        _mm256_storeu_pd(p.ax + i, _mm256_blendv_pd(ax, axn, active));
+        _mm256_storeu_pd(p.ay + i, _mm256_blendv_pd(ay, ayn, active));
+        int wrapX = _mm256_movemask_pd(_mm256_or_pd(loX, hiX));
+        int wrapY = _mm256_movemask_pd(_mm256_or_pd(loY, hiY));
+        for (int k = 0; k < 4; ++k) {
+            unsigned char old = p.state[i + k];
+            unsigned char updated = static_cast<unsigned char>((old & StateActiveMask) | ((wrapX >> k) & 1) | (((wrapY >> k) & 1) << 1));
+            p.state[i + k] = ((activeMask >> k) & 1) ? updated : old;
+        }
+    }
+}
+#endif
+
+// Move particles [begin, end) using the widest SIMD path the compiler was
+// told about (-mavx512f or -mavx2), with the scalar loop for the remainder
+inline void moveParticles(particle_soa& particles, size_t begin, size_t end, double dt) {
+    size_t i = begin;
+#if defined(__AVX512F__) || defined(__AVX2__)
+    moveParticlesSimd(particles, i, end, dt);
+#endif
+    moveParticlesScalar(particles, i, end, dt);
+}
+
+inline void moveParticles(particle_soa& particles, double dt) {
+    moveParticles(particles, 0, particles.size(), dt);
+}
+
+#endif
@@ -0,0 +1,251 @@
+#ifndef PHASE_PROFILE_H
+#define PHASE_PROFILE_H
+#include <cstddef> //needed for size_t
+#include <cstdint>
+#include <string>
+#include <ostream>
+#ifdef USE_PROFILE
+#include <cstring>
+#include <chrono>
+#include <fstream>
+#include <stdexcept>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "latency_histogram.h"
+#endif
+
+// Phases of a step that the sims time separately
+enum Phase {
+    PhaseIntegrate, // Moving particles and wrapping them at the boundaries
+    PhaseMigrate,   // Filling tempvec with wrapped particles and re-inserting them
+    PhaseErase,     // erase_if, pack_chunks and other compaction
+    PhaseForces,
+    PhaseReorder,
+    PhaseOutput,    // Position files, trajectories and checkpoints
+    PhaseCount
+};
+
+inline const char* phaseName(Phase phase) {
+    static const char* const names[PhaseCount] = {"integrate", "migrate", "erase", "forces", "reorder", "output"};
+    return names[phase];
+}
+
+#ifdef USE_PROFILE
+
+// Per-phase wall time, and with counters on the hardware counters of the
+// calling thread, summed over windows of every steps. At the end of each
+// window one record per phase that ran is written to the output file, as
+// CSV rows or, for a path ending in .json, as objects of one JSON array.
+// Phases must not nest: begin() and end() read the counters and charge the
+// difference to the phase. Every call is also recorded in a per-phase
+// latency histogram covering the whole run, see reportLatency().
+class phase_profiler {
+public:
+    static constexpr bool enabled = true;
+    enum Counter { Cycles, Instructions, LLCMisses, BranchMisses, CounterCount };
+
+    // counters: also read cycles, instructions, LLC misses and branch misses
+    // through perf_event_open. If the kernel refuses, only time is recorded
+    // and countersEnabled() says so.
+    phase_profiler(const std::string& path, uint64_t every, bool counters) : every(every) {
+        out.open(path);
+        if (!out) throw std::runtime_error("phase_profiler: cannot open " + path);
+        json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+        if (counters) openCounters();
+        if (json) {
+            out << "[";
+        } else {
+            out << "first_step,last_step,phase,calls,ns,cycles,instructions,llc_misses,branch_misses\n";
+        }
+    }
+
+    phase_profiler(const phase_profiler&) = delete;
+    phase_profiler& operator=(const phase_profiler&) = delete;
+
+    ~phase_profiler() {
+        close();
+        for (int fd : fds) {
+            if (fd >= 0) ::close(fd);
+        }
+    }
+
+    bool countersEnabled() const { return fds[0] >= 0; }
+
+    void begin(Phase phase) {
+        current = phase;
+        readCounters(started);
+        startTime = std::chrono::steady_clock::now();
+    }
+
+    void end() {
+        auto now = std::chrono::steady_clock::now();
+        uint64_t values[CounterCount];
+        readCounters(values);
+        totals& t = window[current];
+        t.calls++;
+        t.ns += std::chrono::duration_cast<std::chrono::nanoseconds>(now - startTime).count();
+        latency[current].record(now - startTime);
+        for (int c = 0; c < CounterCount; ++c) t.counters[c] += values[c] - started[c];
+    }
+
+    // Call after every step; writes out the window when it is complete
+    void endStep(uint64_t step) {
+        if (!windowOpen) {
+            firstStep = step;
+            windowOpen = true;
+        }
+        lastStep = step;
+        if (every > 0 && (step + 1) % every == 0) flush();
+    }
+
+    // Latency percentiles of every phase that ran, one line each
+    void reportLatency(std::ostream& out) const {
+        for (int p = 0; p < PhaseCount; ++p) {
+            if (latency[p].count() > 0) latency[p].report(out, phaseName(static_cast<Phase>(p)));
+        }
+    }
+
+    // Write out any partial window and finish the file
+    void close() {
+        if (!out.is_open()) return;
+        flush();
+        if (json) out << "\n]\n";
+        out.close();
+    }
+
+private:
+    struct totals {
+        uint64_t calls = 0;
+        uint64_t ns = 0;
+        uint64_t counters[CounterCount] = {};
+    };
+
+    std::ofstream out;
+    bool json = false;
+    bool firstRecord = true;
+    uint64_t every;
+    uint64_t firstStep = 0, lastStep = 0;
+    bool windowOpen = false;
+    totals window[PhaseCount];
+    latency_histogram latency[PhaseCount];
+    Phase current = PhaseIntegrate;
+    std::chrono::steady_clock::time_point startTime;
+    uint64_t started[CounterCount] = {};
+    int fds[CounterCount] = {-1, -1, -1, -1};
+
+    // One group led by the cycle counter, so all four are read with a
+    // single read() and are scheduled on the PMU together
+    void openCounters() {
+        static const uint64_t configs[CounterCount][2] = {
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+            {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES}};
+        for (int c = 0; c < CounterCount; ++c) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = static_cast<uint32_t>(configs[c][0]);
+            attr.config = configs[c][1];
+            attr.disabled = c == 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+            int fd = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, c == 0 ? -1 : fds[0], 0));
+            if (fd < 0) {
+                for (int k = 0; k < c; ++k) {
+                    ::close(fds[k]);
+                    fds[k] = -1;
+                }
+                return;
+            }
+            fds[c] = fd;
+        }
+        ::ioctl(fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ::ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    void readCounters(uint64_t* values) {
+        if (fds[0] < 0) {
+            for (int c = 0; c < CounterCount; ++c) values[c] = 0;
+            return;
+        }
+        uint64_t group[1 + CounterCount]; // Number of counters, then the values
+        if (::read(fds[0], group, sizeof(group)) != static_cast<ssize_t>(sizeof(group))) {
+            for (int c = 0; c < CounterCount; ++c) values[c] = 0;
+            return;
+        }
+        for (int c = 0; c < CounterCount; ++c) values[c] = group[1 + c];
+    }
+
+    void flush() {
+        if (!windowOpen) return;
+        for (int p = 0; p < PhaseCount; ++p) {
+            totals& t = window[p];
+            if (t.calls == 0) continue;
+            if (json) {
+                out << (firstRecord ? "\n" : ",\n") << "{\"first_step\":" << firstStep << ",\"last_step\":" << lastStep
+                    << ",\"phase\":\"" << phaseName(static_cast<Phase>(p)) << "\",\"calls\":" << t.calls
+                    << ",\"ns\":" << t.ns;
+                if (countersEnabled()) {
+                    out << ",\"cycles\":" << t.counters[Cycles] << ",\"instructions\":" << t.counters[Instructions]
+                        << ",\"llc_misses\":" << t.counters[LLCMisses] << ",\"branch_misses\":" << t.counters[BranchMisses];
+                }
+                out << "}";
+            } else {
+                out << firstStep << "," << lastStep << "," << phaseName(static_cast<Phase>(p)) << "," << t.calls << "," << t.ns;
+                for (int c = 0; c < CounterCount; ++c) {
+                    out << ",";
+                    if (countersEnabled()) out << t.counters[c];
+                }
+                out << "\n";
+            }
+            firstRecord = false;
+            t = totals();
+        }
+        windowOpen = false;
+    }
+};
+
+// Times one phase for as long as it is in scope
+class phase_scope {
+public:
+    phase_scope(phase_profiler* profiler, Phase phase) : profiler(profiler) {
+        if (profiler) profiler->begin(phase);
+    }
+    ~phase_scope() {
+        if (profiler) profiler->end();
+    }
+    phase_scope(const phase_scope&) = delete;
+    phase_scope& operator=(const phase_scope&) = delete;
+
+private:
+    phase_profiler* profiler;
+};
+
+#else
+
+// Built without USE_PROFILE: the same interface with empty inline bodies,
+// so every call compiles to nothing
+class phase_profiler {
+public:
+    static constexpr bool enabled = false;
+    phase_profiler(const std::string&, uint64_t, bool) {}
+    bool countersEnabled() const { return false; }
+    void begin(Phase) {}
+    void end() {}
+    void endStep(uint64_t) {}
+    void reportLatency(std::ostream&) const {}
+    void close() {}
+};
+
+class phase_scope {
+public:
+    phase_scope(phase_profiler*, Phase) {}
+};
+
+#endif
+
+#endif
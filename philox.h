@@ -0,0 +1,59 @@
+#ifndef PHILOX_H
+#define PHILOX_H
+#include <cstddef> //needed for size_t
+#include <cstdint>
+
+// Philox4x32-10 counter-based generator (Salmon et al., "Parallel random
+// numbers: as easy as 1, 2, 3", SC11). A 128-bit counter and a 64-bit key
+// go through ten rounds of multiply-xor and come out as four independent
+// 32-bit words. There is no state to carry: the same (key, counter) always
+// gives the same words, on any thread, in any order and with any libc, so
+// particle i can draw its numbers without knowing about particle i - 1.
+//
+// The sims use the key for the seed and lay out the counter as
+//   c0, c1: particle index or id (low, high word)
+//   c2:     step
+//   c3:     purpose, one of PhiloxStream
+enum PhiloxStream : uint32_t {
+    PhiloxInitPosition = 0,
+    PhiloxInitVelocity = 1,
+    PhiloxNoise = 2
+};
+
+struct philox_block {
+    uint32_t w[4];
+};
+
+inline philox_block philox4x32(uint32_t c0, uint32_t c1, uint32_t c2, uint32_t c3, uint64_t key) {
+    const uint64_t M0 = 0xD2511F53, M1 = 0xCD9E8D57;
+    const uint32_t W0 = 0x9E3779B9, W1 = 0xBB67AE85;
+    uint32_t k0 = static_cast<uint32_t>(key), k1 = static_cast<uint32_t>(key >> 32);
+    for (int round = 0; round < 10; ++round) {
+        uint64_t p0 = M0 * c0;
+        uint64_t p1 = M1 * c2;
+        uint32_t n0 = static_cast<uint32_t>(p1 >> 32) ^ c1 ^ k0;
+        uint32_t n2 = static_cast<uint32_t>(p0 >> 32) ^ c3 ^ k1;
+        c1 = static_cast<uint32_t>(p1);
+        c3 = static_cast<uint32_t>(p0);
+        c0 = n0;
+        c2 = n2;
+        k0 += W0;
+        k1 += W1;
+    }
+    return {{c0, c1, c2, c3}};
+}
+
+// Uniform in [0, 1) from 53 bits of two words
+inline double philoxUniform(uint32_t hi, uint32_t lo) {
+    uint64_t bits = (static_cast<uint64_t>(hi) << 32) | lo;
+    return static_cast<double>(bits >> 11) * 0x1.0p-53;
+}
+
+// Two uniforms in [0, 1) for one (index, step, stream) of one seed
+inline void philoxUniforms(uint64_t seed, uint64_t index, uint32_t step, uint32_t stream, double& u0, double& u1) {
+    philox_block b = philox4x32(static_cast<uint32_t>(index), static_cast<uint32_t>(index >> 32), step, stream, seed);
+    u0 = philoxUniform(b.w[0], b.w[1]);
+    u1 = philoxUniform(b.w[2], b.w[3]);
+}
+
+#endif
@@ -0,0 +1,202 @@
+#ifndef POOL_ALLOCATOR_H
+#define POOL_ALLOCATOR_H
+#include <cstddef> //needed for size_t
+#include <memory>
+#include <new>
+#include <vector>
+#include <utility>
+
+// Slab allocator for list nodes.
+// Single objects are carved out of blocks of block_size slots and returned
+// to a free list when deallocated, so steady-state push/erase traffic never
+// reaches malloc. Requests for more than one object go to ::operator new.
+// Copies and rebinds share one pool_state, so they compare equal and any of
+// them can free what another allocated; each value type gets its own
+// blocks inside it. Not thread safe.
+struct node_pool_base {
+    virtual ~node_pool_base() {}
+};
+
+// Blocks and free list for one value type
+template <typename T>
+class node_pool : public node_pool_base {
+    // Storage for one object, or the free list link when the slot is unused
+    struct slot {
+        union {
+            alignas(T) unsigned char storage[sizeof(T)];
+            slot *next_free;
+        };
+        bool live = false;
+    };
+    struct block {
+        slot *slots;
+        size_t count;
+        block *next = nullptr;
+    };
+
+    size_t block_size;
+    block *head_block = nullptr, *tail_block = nullptr;
+    slot *free_head = nullptr;
+    size_t used_in_tail = 0;
+
+public:
+    explicit node_pool(size_t block) : block_size(block) {}
+    node_pool(const node_pool &) = delete;
+    node_pool &operator=(const node_pool &) = delete;
+
+    ~node_pool() {
+        block *current = head_block, *next;
+        while (current) {
+            next = current->next;
+            delete[] current->slots;
+            delete current;
+            current = next;
+        }
+    }
+
+    T *allocate() {
+        slot *s;
+        if (free_head) {
+            // Reuse the most recently freed slot, it is likely still in cache
+            s = free_head;
+            free_head = s->next_free;
+        } else {
+            if (!tail_block || used_in_tail == tail_block->count) {
+                add_block();
+            }
+            s = &tail_block->slots[used_in_tail++];
+        }
+        s->live = true;
+        return reinterpret_cast<T *>(s->storage);
+    }
+
+    void deallocate(T *p) {
+        slot *s = reinterpret_cast<slot *>(reinterpret_cast<unsigned char *>(p) - offsetof(slot, storage));
+        s->live = false;
+        s->next_free = free_head;
+        free_head = s;
+    }
+
+    // Call f(object) for every live object in the order it sits in memory
+    template <typename F>
+    void for_each_allocated(F f) {
+        for (block *current = head_block; current; current = current->next) {
+            size_t count = (current == tail_block) ? used_in_tail : current->count;
+            for (size_t i = 0; i < count; ++i) {
+                if (current->slots[i].live) {
+                    f(*reinterpret_cast<T *>(current->slots[i].storage));
+                }
+            }
+        }
+    }
+
+private:
+    void add_block() {
+        block *new_block = new block;
+        new_block->slots = new slot[block_size];
+        new_block->count = block_size;
+        if (!head_block) {
+            head_block = new_block;
+        } else {
+            tail_block->next = new_block;
+        }
+        tail_block = new_block;
+        used_in_tail = 0;
+    }
+};
+
+// The state every copy of a pool_allocator shares: one node_pool per value
+// type, created on first use
+class pool_state {
+    size_t block_size;
+    std::vector<std::pair<const void *, std::unique_ptr<node_pool_base>>> pools;
+
+    // An address unique to each type, to find its pool without RTTI
+    template <typename T>
+    static const void *type_key() {
+        static const char key = 0;
+        return &key;
+    }
+
+public:
+    explicit pool_state(size_t block) : block_size(block ? block : 1) {}
+    size_t get_block_size() const { return block_size; }
+
+    template <typename T>
+    node_pool<T> &pool() {
+        for (auto &entry : pools) {
+            if (entry.first == type_key<T>()) return static_cast<node_pool<T> &>(*entry.second);
+        }
+        pools.emplace_back(type_key<T>(), std::make_unique<node_pool<T>>(block_size));
+        return static_cast<node_pool<T> &>(*pools.back().second);
+    }
+};
+
+template <typename T>
+class pool_allocator {
+    template <typename U>
+    friend class pool_allocator;
+
+    std::shared_ptr<pool_state> state;
+    node_pool<T> *nodes = nullptr; // This type's pool in state, looked up on first use
+
+    node_pool<T> &get_pool() {
+        if (!nodes) nodes = &state->template pool<T>();
+        return *nodes;
+    }
+
+public:
+    using value_type = T;
+    template <typename U>
+    struct rebind {
+        using other = pool_allocator<U>;
+    };
+    // Containers take their pool with them, so swapped or assigned nodes
+    // are always freed to the pool that made them
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    static const size_t default_block_size = 1024;
+
+    explicit pool_allocator(size_t block = default_block_size) : state(std::make_shared<pool_state>(block)) {}
+    pool_allocator(const pool_allocator &other) : state(other.state), nodes(other.nodes) {}
+    template <typename U>
+    pool_allocator(const pool_allocator<U> &other) : state(other.state) {}
+    pool_allocator &operator=(const pool_allocator &other) {
+        state = other.state;
+        nodes = other.nodes;
+        return *this;
+    }
+
+    size_t get_block_size() const { return state->get_block_size(); }
+
+    T *allocate(size_t n) {
+        if (n != 1) {
+            return static_cast<T *>(::operator new(n * sizeof(T)));
+        }
+        return get_pool().allocate();
+    }
+
+    void deallocate(T *p, size_t n) {
+        if (n != 1) {
+            ::operator delete(p);
+            return;
+        }
+        get_pool().deallocate(p);
+    }
+
+    // Call f(object) for every live object in the order it sits in memory,
+    // across every container sharing this pool
+    template <typename F>
+    void for_each_allocated(F f) {
+        get_pool().for_each_allocated(f);
+    }
+
+    template <typename U>
+    bool operator==(const pool_allocator<U> &other) const { return state == other.state; }
+    template <typename U>
+    bool operator!=(const pool_allocator<U> &other) const { return state != other.state; }
+};
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef REORDER_H
+#define REORDER_H
+#include <cstddef> //needed for size_t
+#include <cstdint>
+#include <cmath>
+#include <vector>
+#include "particle.h"
+#include "thread_pool.h"
+#include "chunk_list.h"
+#include "cell_list.h"
+#include "space_filling.h"
+
+// Mean minimum-image distance between consecutive active particles in
+// container order. Small when neighbours in memory are neighbours in space.
+template <typename Container>
+double locality(Container& particles) {
+    double total = 0.0;
+    size_t pairs = 0;
+    const Particle* previous = nullptr;
+    for (const auto& p : particles) {
+        if (p.active != Active) continue;
+        if (previous) {
+            double dx = minimumImage(p.position[0] - previous->position[0]);
+            double dy = minimumImage(p.position[1] - previous->position[1]);
+            total += std::sqrt(dx * dx + dy * dy);
+            pairs++;
+        }
+        previous = &p;
+    }
+    return pairs ? total / pairs : 0.0;
+}
+
+// When to reorder: every interval steps, or when locality() has grown to
+// degradation times its value just after the last reorder. Either can be
+// switched off with 0. The locality check itself is a pass over the
+// particles, so it is only made every check steps.
+struct reorder_policy {
+    Curve curve = Hilbert;
+    int interval = 0;
+    double degradation = 0.0;
+    int check = 10;
+    double baseline = 0.0; // locality() after the last reorder
+
+    template <typename Container>
+    bool due(int step, Container& particles) const {
+        if (interval > 0 && step % interval == 0) return true;
+        if (degradation > 0 && check > 0 && step % check == 0) {
+            return baseline == 0.0 || locality(particles) > degradation * baseline;
+        }
+        return false;
+    }
+};
+
+// Curve keys of every particle in container order. Inactive particles get
+// the largest key so they sort to the end.
+template <typename Container>
+void particleKeys(const Container& particles, Curve curve, std::vector<uint32_t>& keys, thread_pool& pool) {
+    keys.resize(particles.size());
+    pool.parallel_for(particles.size(), [&](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            const Particle& p = particles[i];
+            keys[i] = p.active == Active ? curveKey(curve, p.position[0], p.position[1]) : UINT32_MAX;
+        }
+    });
+}
+
+// Sort a random-access container (std::vector, basic_vector) along the
+// curve: radix sort the keys, gather the particles into a scratch buffer in
+// the new order and copy them back, both in parallel
+template <typename Container>
+void sortParticles(Container& particles, Curve curve, thread_pool& pool) {
+    size_t n = particles.size();
+    std::vector<uint32_t> keys;
+    particleKeys(particles, curve, keys, pool);
+    std::vector<size_t> order(n);
+    for (size_t i = 0; i < n; ++i) order[i] = i;
+    radixSort(keys, order, pool);
+
+    std::vector<Particle> sorted(n);
+    pool.parallel_for(n, [&](size_t, size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) sorted[k] = particles[order[k]];
+    });
+    pool.parallel_for(n, [&](size_t, size_t begin, size_t end) {
+        for (size_t k = begin; k < end; ++k) particles[k] = sorted[k];
+    });
+}
+
+// chunk_list has no random access, so the keys are taken in list order and
+// pack_chunks() rebuilds the chunks in sorted order
+inline void sortParticles(chunk_list<Particle>& particles, Curve curve, thread_pool& pool) {
+    std::vector<uint32_t> keys;
+    keys.reserve(particles.size());
+    for (const auto& p : particles) {
+        keys.push_back(p.active == Active ? curveKey(curve, p.position[0], p.position[1]) : UINT32_MAX);
+    }
+    std::vector<size_t> order(keys.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    radixSort(keys, order, pool);
+    particles.pack_chunks(order);
+}
+
+// Reorder if the policy says so. Returns true if the container was sorted,
+// in which case anything holding container indices must be rebuilt.
+template <typename Container>
+bool reorderParticles(Container& particles, int step, reorder_policy& policy, thread_pool& pool) {
+    if (!policy.due(step, particles)) return false;
+    sortParticles(particles, policy.curve, pool);
+    if (policy.degradation > 0) policy.baseline = locality(particles);
+    return true;
+}
+
+#endif
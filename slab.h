@@ -0,0 +1,83 @@
+#ifndef SLAB_H
+#define SLAB_H
+#include <cstddef> //needed for size_t
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include "particle.h"
+#include "transport.h"
+#include "cell_list.h" // minimumImage
+
+// The x-slab [x0, x1) of the periodic box owned by one rank, with the
+// buffers for migrating particles to the neighbouring slabs
+struct slab {
+    double x0, x1;
+    std::vector<Particle> toLeft, toRight, received;
+    std::vector<char> band;
+    double margin = 1.0; // Largest x displacement possible this step; 1 puts everything in the band
+
+    slab(int rank, int ranks)
+        : x0(static_cast<double>(rank) / ranks), x1(static_cast<double>(rank + 1) / ranks) {}
+
+    bool contains(double x) const { return x >= x0 && x < x1; }
+};
+
+// Velocity-Verlet step of a rank's particles with migration between slabs.
+// Particles within margin of an edge are moved first and the ones that
+// left are sent off; the interior, which cannot leave this step, is moved
+// while the batches are in flight. The margin for the next step is bounded
+// from the velocities and accelerations the drift will use, so nothing in
+// the interior ever needs a second exchange. Slabs must be wider than a
+// step's displacement. Returns the number of particles sent.
+inline size_t moveParticlesSlab(std::vector<Particle>& particles, double dt, slab& s, migration_transport& transport) {
+    s.toLeft.clear();
+    s.toRight.clear();
+    size_t n = particles.size();
+    s.band.resize(n);
+
+    // Boundary band
+    for (size_t i = 0; i < n; ++i) {
+        Particle& p = particles[i];
+        double x = p.position[0];
+        s.band[i] = (x - s.x0 < s.margin || s.x1 - x < s.margin);
+        if (!s.band[i]) continue;
+        moveParticle(p, dt);
+        if (s.contains(p.position[0])) continue;
+        // The direction it went decides the neighbour, wrapped or not
+        if (minimumImage(p.position[0] - x) < 0) {
+            s.toLeft.push_back(p);
+        } else {
+            s.toRight.push_back(p);
+        }
+        p.active = Removed;
+    }
+    transport.start(s.toLeft, s.toRight);
+
+    // Interior, overlapped with the transfer
+    for (size_t i = 0; i < n; ++i) {
+        if (!s.band[i]) moveParticle(particles[i], dt);
+    }
+
+    // Bound next step's drift, |vx dt + ax dt^2 / 2|, over the particles
+    // that stay, with a little slack for rounding
+    double vmax = 0.0, amax = 0.0;
+    for (const auto& p : particles) {
+        if (p.active != Active) continue;
+        vmax = std::max(vmax, std::fabs(p.velocity[0]));
+        amax = std::max(amax, std::fabs(p.acceleration[0]));
+    }
+
+    s.received.clear();
+    transport.finish(s.received);
+    for (const auto& p : s.received) {
+        vmax = std::max(vmax, std::fabs(p.velocity[0]));
+        amax = std::max(amax, std::fabs(p.acceleration[0]));
+    }
+    s.margin = (vmax * dt + 0.5 * amax * dt * dt) * 1.001 + 1e-12;
+
+    std::erase_if(particles, [](const Particle& p) { return p.active != Active; });
+    particles.insert(particles.end(), s.received.begin(), s.received.end());
+    return s.toLeft.size() + s.toRight.size();
+}
+
+#endif
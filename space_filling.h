@@ -0,0 +1,104 @@
+#ifndef SPACE_FILLING_H
+#define SPACE_FILLING_H
+#include <cstddef> //needed for size_t
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include "thread_pool.h"
+
+// Space-filling curves over the unit box, 16 bits per axis
+enum Curve {
+    Morton, // Z-order: bit interleaving, cheap but jumps at quadrant edges
+    Hilbert // Never jumps: consecutive keys are always adjacent cells
+};
+
+// Cell coordinate of a position, clamped so positions at exactly 1 still fit
+inline uint32_t quantise(double v) {
+    return static_cast<uint32_t>(std::clamp(v * 65536.0, 0.0, 65535.0));
+}
+
+// Interleave the bits of two 16-bit cell coordinates into a Morton key
+inline uint32_t mortonKey(uint32_t qx, uint32_t qy) {
+    auto spread = [](uint32_t v) {
+        v = (v | (v << 8)) & 0x00FF00FF;
+        v = (v | (v << 4)) & 0x0F0F0F0F;
+        v = (v | (v << 2)) & 0x33333333;
+        v = (v | (v << 1)) & 0x55555555;
+        return v;
+    };
+    return spread(qx) | (spread(qy) << 1);
+}
+
+// Distance along the Hilbert curve through the 65536 x 65536 cells
+inline uint32_t hilbertKey(uint32_t qx, uint32_t qy) {
+    uint32_t key = 0;
+    for (uint32_t s = 1u << 15; s > 0; s >>= 1) {
+        uint32_t rx = (qx & s) ? 1 : 0;
+        uint32_t ry = (qy & s) ? 1 : 0;
+        key += s * s * ((3 * rx) ^ ry);
+        // Rotate the quadrant so the curve inside it starts and ends at the
+        // right corners
+        if (ry == 0) {
+            if (rx == 1) {
+                qx = s - 1 - (qx & (s - 1));
+                qy = s - 1 - (qy & (s - 1));
+            }
+            std::swap(qx, qy);
+        }
+    }
+    return key;
+}
+
+inline uint32_t curveKey(Curve curve, double x, double y) {
+    return curve == Hilbert ? hilbertKey(quantise(x), quantise(y)) : mortonKey(quantise(x), quantise(y));
+}
+
+// Stable parallel LSD radix sort of values by 32-bit keys, 8 bits a pass.
+// Each thread counts the digits in its block, the counts are turned into
+// write offsets in thread order, and each thread scatters its block; so the
+// result is the same as a serial stable sort for any thread count. Passes
+// where every key has the same digit are skipped.
+template <typename Value>
+void radixSort(std::vector<uint32_t>& keys, std::vector<Value>& values, thread_pool& pool) {
+    size_t n = keys.size();
+    size_t threads = pool.size();
+    std::vector<uint32_t> keyScratch(n);
+    std::vector<Value> valueScratch(n);
+    std::vector<size_t> counts(threads * 256);
+
+    for (int shift = 0; shift < 32; shift += 8) {
+        std::fill(counts.begin(), counts.end(), 0);
+        pool.parallel_for(n, [&](size_t t, size_t begin, size_t end) {
+            size_t* count = &counts[t * 256];
+            for (size_t i = begin; i < end; ++i) count[(keys[i] >> shift) & 0xFF]++;
+        });
+
+        // Offsets: digit-major, then thread order within a digit
+        size_t offset = 0;
+        bool trivial = false;
+        for (size_t d = 0; d < 256; ++d) {
+            size_t digitTotal = 0;
+            for (size_t t = 0; t < threads; ++t) {
+                size_t c = counts[t * 256 + d];
+                counts[t * 256 + d] = offset;
+                offset += c;
+                digitTotal += c;
+            }
+            if (digitTotal == n) trivial = true;
+        }
+        if (trivial) continue; // Every key has this digit, nothing moves
+
+        pool.parallel_for(n, [&](size_t t, size_t begin, size_t end) {
+            size_t* next = &counts[t * 256];
+            for (size_t i = begin; i < end; ++i) {
+                size_t slot = next[(keys[i] >> shift) & 0xFF]++;
+                keyScratch[slot] = keys[i];
+                valueScratch[slot] = values[i];
+            }
+        });
+        keys.swap(keyScratch);
+        values.swap(valueScratch);
+    }
+}
+
+#endif
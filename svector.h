@@ -1,7 +1,14 @@
+#ifndef SVECTOR_H
+#define SVECTOR_H
 #include <cstddef> // for std::size_t
 #include <stdexcept> // for std::out_of_range
 #include <limits> // for std::numeric_limits
-#include <utility> // for std::swap
+#include <utility> // for std::swap, std::move, std::forward
+#include <iterator> // for std::random_access_iterator_tag
+#include <new> // for aligned operator new
+#include <memory> // for the uninitialized algorithms
+#include <cstring> // for std::memcpy, std::memmove
+#include <type_traits> // for std::is_trivially_copyable
 
 template <typename T>
 class basic_vector {
@@ -115,13 +122,19 @@ public:
         pointer ptr;
     };
     
+    // Storage is raw memory aligned to at least a cache line. Elements are
+    // constructed in place, so capacity beyond size() holds no objects.
+    static constexpr size_type alignment = alignof(T) > 64 ? alignof(T) : 64;
+
     // constructors
     basic_vector() : udata(nullptr), sz(0), cap(0) {}
-    explicit basic_vector(size_type n) : udata(new T[n]), sz(n), cap(n) {}
-    basic_vector(const basic_vector& other) : udata(new T[other.sz]), sz(other.sz), cap(other.sz) {
-        for (size_type i = 0; i < sz; ++i) {
-            udata[i] = other.udata[i];
-        }
+    explicit basic_vector(size_type n) : udata(allocate(n)), sz(0), cap(n) {
+        std::uninitialized_value_construct_n(udata, n);
+        sz = n;
+    }
+    basic_vector(const basic_vector& other) : udata(allocate(other.sz)), sz(0), cap(other.sz) {
+        copy_construct(udata, other.udata, other.sz);
+        sz = other.sz;
     }
     basic_vector(basic_vector&& other) noexcept : udata(other.udata), sz(other.sz), cap(other.cap) {
         other.udata = nullptr;
@@ -131,26 +144,23 @@ public:
     
     // destructor
     ~basic_vector() {
-        delete[] udata;
+        std::destroy_n(udata, sz);
+        deallocate(udata);
     }
     
     // assignment operators
     basic_vector& operator=(const basic_vector& other) {
         if (this != &other) {
-            delete[] udata;
-            udata = new T[other.sz];
-            sz = other.sz;
-            cap = other.sz;
-            for (size_type i = 0; i < sz; ++i) {
-                udata[i] = other.udata[i];
-            }
+            basic_vector tmp(other);
+            swap(tmp);
         }
         return *this;
     }
     
     basic_vector& operator=(basic_vector&& other) noexcept {
         if (this != &other) {
-            delete[] udata;
+            std::destroy_n(udata, sz);
+            deallocate(udata);
             udata = other.udata;
             sz = other.sz;
             cap = other.cap;
@@ -165,6 +175,10 @@ public:
     reference operator[](size_type n) {
         return udata[n];
     }
+
+    const_reference operator[](size_type n) const {
+        return udata[n];
+    }
     
     reference at(size_type n) {
         if (n >= sz) {
@@ -172,6 +186,22 @@ public:
         }
         return udata[n];
     }
+
+    reference front() {
+        return udata[0];
+    }
+
+    reference back() {
+        return udata[sz - 1];
+    }
+
+    pointer data() noexcept {
+        return udata;
+    }
+
+    const_pointer data() const noexcept {
+        return udata;
+    }
     
     // iterators
     iterator begin() noexcept {
@@ -187,51 +217,120 @@ public:
         return sz;
     }
 
+    size_type capacity() const noexcept {
+        return cap;
+    }
+
+    bool empty() const noexcept {
+        return sz == 0;
+    }
+
+    // Grow the storage to hold at least n elements, relocating the existing
+    // ones with a single memcpy when T is trivially copyable and by move
+    // construction otherwise
     void reserve(size_type n) {
         if (n > cap) {
-            pointer new_data = new T[n];
-            for (size_type i = 0; i < sz; ++i) {
-                new_data[i] = udata[i];
-            }
-            delete[] udata;
+            pointer new_data = allocate(n);
+            relocate(new_data, udata, sz);
+            deallocate(udata);
             udata = new_data;
             cap = n;
         }
     }
 
+    // Release unused capacity
+    void shrink_to_fit() {
+        if (cap > sz) {
+            pointer new_data = sz ? allocate(sz) : nullptr;
+            relocate(new_data, udata, sz);
+            deallocate(udata);
+            udata = new_data;
+            cap = sz;
+        }
+    }
+
+    void resize(size_type n) {
+        if (n < sz) {
+            std::destroy(udata + n, udata + sz);
+        } else if (n > sz) {
+            reserve(n);
+            std::uninitialized_value_construct(udata + sz, udata + n);
+        }
+        sz = n;
+    }
+
+    // As resize(), but new elements are default-initialised: for trivial T
+    // their storage is left untouched for the caller to fill
+    void resize_uninitialized(size_type n) {
+        if (n < sz) {
+            std::destroy(udata + n, udata + sz);
+        } else if (n > sz) {
+            reserve(n);
+            std::uninitialized_default_construct(udata + sz, udata + n);
+        }
+        sz = n;
+    }
+
     void push_back(const T& val) {
+        emplace_back(val);
+    }
+
+    void push_back(T&& val) {
+        emplace_back(std::move(val));
+    }
+
+    // Construct a new element at the end in place
+    template <typename... Args>
+    reference emplace_back(Args&&... args) {
         if (sz == cap) {
-            reserve(cap == 0 ? 1 : cap * 2);
+            // Build the new element in the new storage before moving the old
+            // ones, so args that refer into this vector are still valid
+            size_type new_cap = grow_capacity(sz + 1);
+            pointer new_data = allocate(new_cap);
+            ::new (static_cast<void*>(new_data + sz)) T(std::forward<Args>(args)...);
+            relocate(new_data, udata, sz);
+            deallocate(udata);
+            udata = new_data;
+            cap = new_cap;
+        } else {
+            ::new (static_cast<void*>(udata + sz)) T(std::forward<Args>(args)...);
         }
-        udata[sz] = val;
         ++sz;
+        return udata[sz - 1];
+    }
+
+    void pop_back() {
+        --sz;
+        std::destroy_at(udata + sz);
     }
     
     // modifiers
     void clear() noexcept {
+        std::destroy_n(udata, sz);
         sz = 0;
     }
     
     iterator insert(iterator pos, const T& val) {
+        return emplace(pos, val);
+    }
+
+    iterator insert(iterator pos, T&& val) {
+        return emplace(pos, std::move(val));
+    }
+
+    template <typename... Args>
+    iterator emplace(iterator pos, Args&&... args) {
         difference_type index = pos - begin();
-        if (sz == cap) {
-            reserve(cap == 0 ? 1 : cap * 2);
-        }
-        for (size_type i = sz; i > static_cast<size_type>(index); --i) {
-            udata[i] = udata[i-1];
-        }
-        udata[index] = val;
+        // Build the value first in case args refer into this vector
+        T tmp(std::forward<Args>(args)...);
+        open_gap(static_cast<size_type>(index), 1);
+        ::new (static_cast<void*>(udata + index)) T(std::move(tmp));
         ++sz;
         return iterator(udata + index);
     }
     
     iterator erase(iterator pos) {
-        difference_type index = pos - begin();
-        for (size_type i = static_cast<size_type>(index); i < sz-1; ++i) {
-            udata[i] = udata[i+1];
-        }
-        --sz;
-        return iterator(udata + index);
+        return erase(pos, pos + 1);
     }
     
     void swap(basic_vector& other) noexcept {
@@ -242,42 +341,93 @@ public:
 
     iterator insert(iterator pos, size_type n, const T& val) {
         difference_type index = pos - begin();
-        if (sz + n > cap) {
-            reserve(sz + n);
-        }
-        for (size_type i = sz + n - 1; i > static_cast<size_type>(index + n - 1); --i) {
-            udata[i] = udata[i-n];
-        }
-        for (size_type i = static_cast<size_type>(index); i < static_cast<size_type>(index + n); ++i) {
-            udata[i] = val;
+        if (n == 0) {
+            return pos;
         }
+        T tmp(val);
+        open_gap(static_cast<size_type>(index), n);
+        std::uninitialized_fill_n(udata + index, n, tmp);
         sz += n;
         return iterator(udata + index);
     }
 
-    template <typename InputIterator>
+    // Not considered for integral arguments so insert(pos, n, val) with an
+    // int value picks the fill overload
+    template <typename InputIterator, typename = std::enable_if_t<!std::is_integral_v<InputIterator>>>
     iterator insert(iterator pos, InputIterator first, InputIterator last) {
         difference_type index = pos - begin();
-        size_type n = last - first;
-        if (sz + n > cap) {
-            reserve(sz + n);
-        }
-        for (size_type i = sz + n - 1; i > static_cast<size_type>(index + n - 1); --i) {
-            udata[i] = udata[i-n];
-        }
-        for (size_type i = static_cast<size_type>(index); i < static_cast<size_type>(index + n); ++i) {
-            udata[i] = *first;
-            ++first;
+        size_type n = static_cast<size_type>(std::distance(first, last));
+        if (n == 0) {
+            return pos;
         }
+        open_gap(static_cast<size_type>(index), n);
+        std::uninitialized_copy(first, last, udata + index);
         sz += n;
         return iterator(udata + index);
     }
 
+    // Unordered O(1) removal: the last element is moved into pos and the
+    // vector shrinks by one. Returns pos, which now holds the moved element
+    // (or end() if pos was the last element).
+    iterator swap_remove(iterator pos) {
+        size_type index = static_cast<size_type>(pos - begin());
+        if (index != sz - 1) {
+            udata[index] = std::move(udata[sz - 1]);
+        }
+        pop_back();
+        return iterator(udata + index);
+    }
+
+    // Unordered erase_if: each removed element is replaced by the current
+    // last one. The predicate still runs once per element, but only the
+    // removed ones cause a move, where erase_if shifts every survivor after
+    // the first removal. Returns the number removed.
+    template <typename Predicate>
+    size_type unordered_erase_if(Predicate pred) {
+        size_type before = sz;
+        size_type i = 0;
+        while (i < sz) {
+            if (pred(udata[i])) {
+                swap_remove(iterator(udata + i));
+            } else {
+                ++i;
+            }
+        }
+        return before - sz;
+    }
+
+    // Remove every element for which pred returns true in a single stable
+    // pass, without allocating. Returns the number of elements removed.
+    template <typename Predicate>
+    size_type erase_if(Predicate pred) {
+        size_type out = 0;
+        for (size_type i = 0; i < sz; ++i) {
+            if (pred(udata[i])) {
+                continue;
+            }
+            if (out != i) {
+                udata[out] = std::move(udata[i]);
+            }
+            ++out;
+        }
+        size_type removed = sz - out;
+        std::destroy(udata + out, udata + sz);
+        sz = out;
+        return removed;
+    }
+
     iterator erase(iterator first, iterator last) {
         difference_type index = first - begin();
-        difference_type n = last - first;
-        for (size_type i = static_cast<size_type>(index); i < sz - n; ++i) {
-            udata[i] = udata[i+n];
+        size_type n = static_cast<size_type>(last - first);
+        if (n == 0) {
+            return first;
+        }
+        size_type tail = sz - index - n;
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            std::memmove(static_cast<void*>(udata + index), udata + index + n, tail * sizeof(T));
+        } else {
+            std::move(udata + index + n, udata + sz, udata + index);
+            std::destroy(udata + sz - n, udata + sz);
         }
         sz -= n;
         return iterator(udata + index);
@@ -287,5 +437,77 @@ private:
     pointer udata;
     size_type sz;
     size_type cap;
+
+    static pointer allocate(size_type n) {
+        if (n == 0) {
+            return nullptr;
+        }
+        return static_cast<pointer>(::operator new(n * sizeof(T), std::align_val_t(alignment)));
+    }
+
+    static void deallocate(pointer p) {
+        if (p) {
+            ::operator delete(p, std::align_val_t(alignment));
+        }
+    }
+
+    // Capacity to grow to when at least n elements are needed
+    size_type grow_capacity(size_type n) const {
+        size_type doubled = cap == 0 ? 1 : cap * 2;
+        return doubled > n ? doubled : n;
+    }
+
+    static void copy_construct(pointer dst, const_pointer src, size_type n) {
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            if (n) std::memcpy(static_cast<void*>(dst), src, n * sizeof(T));
+        } else {
+            std::uninitialized_copy_n(src, n, dst);
+        }
+    }
+
+    // Move n elements from src to uninitialised dst and end their lifetime
+    // at src. The ranges must not overlap.
+    static void relocate(pointer dst, pointer src, size_type n) {
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            if (n) std::memcpy(static_cast<void*>(dst), src, n * sizeof(T));
+        } else {
+            std::uninitialized_move_n(src, n, dst);
+            std::destroy_n(src, n);
+        }
+    }
+
+    // Make room for n uninitialised elements at index, growing the storage
+    // if needed. sz is not changed; the caller constructs into the gap.
+    void open_gap(size_type index, size_type n) {
+        size_type tail = sz - index;
+        if (sz + n > cap) {
+            size_type new_cap = grow_capacity(sz + n);
+            pointer new_data = allocate(new_cap);
+            relocate(new_data, udata, index);
+            relocate(new_data + index + n, udata + index, tail);
+            deallocate(udata);
+            udata = new_data;
+            cap = new_cap;
+            return;
+        }
+        if constexpr (std::is_trivially_copyable_v<T>) {
+            std::memmove(static_cast<void*>(udata + index + n), udata + index, tail * sizeof(T));
+        } else {
+            // Shift the tail up one element at a time from the back, so
+            // overlapping source and destination are handled
+            for (size_type i = tail; i > 0; --i) {
+                pointer from = udata + index + i - 1;
+                ::new (static_cast<void*>(from + n)) T(std::move(*from));
+                std::destroy_at(from);
+            }
+        }
+    }
 };
 
+namespace std {
+    template <typename T, typename Predicate>
+    size_t erase_if(basic_vector<T>& vec, Predicate pred) {
+        return vec.erase_if(pred);
+    }
+};
+#endif
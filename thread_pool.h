@@ -0,0 +1,105 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+#include <cstddef> //needed for size_t
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+
+// Fixed set of worker threads that run one job at a time.
+// run() hands job(t) to every thread t in [0, size()) and blocks until they
+// have all finished. Thread 0 is the calling thread, so a pool of size 1
+// never starts a worker and runs everything inline.
+class thread_pool {
+public:
+    explicit thread_pool(size_t threads) : nthreads(threads == 0 ? 1 : threads) {
+        for (size_t t = 1; t < nthreads; ++t) {
+            workers.emplace_back([this, t] { worker(t); });
+        }
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    ~thread_pool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            ++generation;
+        }
+        wake.notify_all();
+        for (auto& w : workers) w.join();
+    }
+
+    size_t size() const { return nthreads; }
+
+    // Run job(t) on every thread and wait for completion
+    void run(const std::function<void(size_t)>& job) {
+        if (nthreads == 1) {
+            job(0);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            current = &job;
+            remaining = nthreads - 1;
+            ++generation;
+        }
+        wake.notify_all();
+        job(0);
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return remaining == 0; });
+        current = nullptr;
+    }
+
+    // Split [0, n) into size() contiguous blocks and call body(t, begin, end).
+    // The split only depends on n and size(), so block t always covers the
+    // same range for a given thread count.
+    void parallel_for(size_t n, const std::function<void(size_t, size_t, size_t)>& body) {
+        run([&](size_t t) {
+            size_t begin, end;
+            block(n, t, begin, end);
+            body(t, begin, end);
+        });
+    }
+
+    // Range of block t when [0, n) is split between size() threads
+    void block(size_t n, size_t t, size_t& begin, size_t& end) const {
+        size_t per = n / nthreads, extra = n % nthreads;
+        begin = t * per + (t < extra ? t : extra);
+        end = begin + per + (t < extra ? 1 : 0);
+    }
+
+private:
+    size_t nthreads;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake, done;
+    const std::function<void(size_t)> *current = nullptr;
+    size_t remaining = 0;
+    unsigned long generation = 0;
+    bool stopping = false;
+
+    void worker(size_t t) {
+        unsigned long seen = 0;
+        while (true) {
+            const std::function<void(size_t)> *job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return generation != seen; });
+                seen = generation;
+                if (stopping) return;
+                job = current;
+            }
+            (*job)(t);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                --remaining;
+            }
+            done.notify_one();
+        }
+    }
+};
+
+#endif
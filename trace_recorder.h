@@ -0,0 +1,130 @@
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+#include <cstddef> //needed for size_t
+#include <cstdint>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdexcept>
+#include "phase_profile.h"
+
+// One timed phase on one thread, in nanoseconds since the recorder started
+struct trace_event {
+    uint64_t begin;
+    uint64_t end;
+    uint64_t step;
+    Phase phase;
+};
+
+// Records which thread ran which phase when, for viewing in chrome://tracing
+// or Perfetto. Every thread of the pool has its own fixed-size ring of
+// events, written only by that thread, so recording takes no locks and
+// never allocates; when a ring is full the oldest events are overwritten
+// and counted in dropped(). Only every every-th step is recorded, so a long
+// run gives a trace of bounded size. write() must not overlap recording.
+class trace_recorder {
+public:
+    // threads: rings to keep, one per pool thread (thread 0 is the caller)
+    // capacity: events per ring
+    trace_recorder(size_t threads, size_t capacity, uint64_t every)
+        : every(every), start(std::chrono::steady_clock::now()), rings(threads == 0 ? 1 : threads) {
+        for (auto& ring : rings) ring.events.resize(capacity == 0 ? 1 : capacity);
+    }
+
+    trace_recorder(const trace_recorder&) = delete;
+    trace_recorder& operator=(const trace_recorder&) = delete;
+
+    // Call on the main thread before each step, outside any parallel region
+    void beginStep(uint64_t step) {
+        currentStep = step;
+        sampled = every > 0 && step % every == 0;
+    }
+
+    bool sampling() const { return sampled; }
+
+    uint64_t now() const {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    void record(size_t thread, Phase phase, uint64_t begin, uint64_t end) {
+        if (!sampled || thread >= rings.size()) return;
+        ring& r = rings[thread];
+        r.events[r.next % r.events.size()] = {begin, end, currentStep, phase};
+        r.next++;
+    }
+
+    uint64_t dropped() const {
+        uint64_t total = 0;
+        for (const auto& r : rings) {
+            if (r.next > r.events.size()) total += r.next - r.events.size();
+        }
+        return total;
+    }
+
+    // Write the events still in the rings as Chrome trace JSON, one track
+    // per thread, oldest event first
+    void write(const std::string& path) const {
+        std::ofstream out(path);
+        if (!out) throw std::runtime_error("trace_recorder: cannot open " + path);
+        out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        bool first = true;
+        for (size_t t = 0; t < rings.size(); ++t) {
+            out << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t
+                << ",\"args\":{\"name\":\"" << (t == 0 ? "main" : "worker " + std::to_string(t)) << "\"}}";
+            first = false;
+        }
+        out.setf(std::ios::fixed);
+        out.precision(3);
+        for (size_t t = 0; t < rings.size(); ++t) {
+            const ring& r = rings[t];
+            size_t size = r.events.size();
+            uint64_t held = r.next < size ? r.next : size;
+            for (uint64_t k = r.next - held; k < r.next; ++k) {
+                const trace_event& e = r.events[k % size];
+                // Complete events: start and duration in microseconds
+                out << ",\n{\"name\":\"" << phaseName(e.phase) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << t
+                    << ",\"ts\":" << e.begin / 1000.0 << ",\"dur\":" << (e.end - e.begin) / 1000.0
+                    << ",\"args\":{\"step\":" << e.step << "}}";
+            }
+        }
+        out << "\n]}\n";
+        if (!out) throw std::runtime_error("trace_recorder: write to " + path + " failed");
+    }
+
+private:
+    struct alignas(64) ring {
+        std::vector<trace_event> events;
+        uint64_t next = 0; // Events recorded so far; next slot is next % size
+    };
+
+    uint64_t every;
+    uint64_t currentStep = 0;
+    bool sampled = false;
+    std::chrono::steady_clock::time_point start;
+    std::vector<ring> rings;
+};
+
+// Records one phase on one thread for as long as it is in scope. A null
+// recorder or an unsampled step costs one branch.
+class trace_scope {
+public:
+    trace_scope(trace_recorder* recorder, size_t thread, Phase phase)
+        : recorder(recorder && recorder->sampling() ? recorder : nullptr), thread(thread), phase(phase) {
+        if (this->recorder) begin = this->recorder->now();
+    }
+    ~trace_scope() {
+        if (recorder) recorder->record(thread, phase, begin, recorder->now());
+    }
+    trace_scope(const trace_scope&) = delete;
+    trace_scope& operator=(const trace_scope&) = delete;
+
+private:
+    trace_recorder* recorder;
+    size_t thread;
+    Phase phase;
+    uint64_t begin = 0;
+};
+
+#endif
@@ -0,0 +1,40 @@
+// Print a binary trajectory written by the sims as text, one particle per
+// line in the same style as the old particle-positions.txt output.
+//
+// Usage: trajectory-dump file [frame]
+// Without a frame number only the header and frame count are printed.
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include "trajectory.h"
+
+int main(int argc, char** argv) {
+    if (argc != 2 && argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " file [frame]" << "\n";
+        exit(1);
+    }
+    trajectory_reader reader(argv[1]);
+    std::cout << "Frames: " << reader.frames() << ", dt: " << reader.dt() << ", fields:";
+    if (reader.fields() & TrajectoryPositions) std::cout << " positions";
+    if (reader.fields() & TrajectoryVelocities) std::cout << " velocities";
+    if (reader.fields() & TrajectoryFlags) std::cout << " flags";
+    std::cout << "\n";
+    if (argc == 2) return 0;
+
+    size_t index = std::stoul(argv[2]);
+    if (index >= reader.frames()) {
+        std::cerr << "Frame " << index << " out of range\n";
+        exit(1);
+    }
+    trajectory_reader::frame f = reader[index];
+    std::cout << "Step " << f.step << ", " << f.count << " particles\n";
+    for (size_t p = 0; p < f.count; ++p) {
+        if (f.flags && stateActive(f.flags[p]) != Active) continue;
+        std::cout << f.x[p] << " " << f.y[p];
+        if (f.vx) std::cout << "  v " << f.vx[p] << " " << f.vy[p];
+        if (f.flags && (f.flags[p] & StateWrapX)) std::cout << "  (Wrapped-X)";
+        if (f.flags && (f.flags[p] & StateWrapY)) std::cout << "  (Wrapped-Y)";
+        std::cout << "\n";
+    }
+    return 0;
+}
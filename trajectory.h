@@ -0,0 +1,273 @@
+#ifndef TRAJECTORY_H
+#define TRAJECTORY_H
+#include <cstddef> //needed for size_t
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include "particle.h"
+#include "particle_soa.h"
+#include "file_io.h"
+
+// Binary trajectory file:
+//   trajectory_header (64 bytes)
+//   per frame: frame_header, then count doubles each of x and y, then
+//   optionally count doubles each of vx and vy, then optionally count state
+//   bytes (the particle_soa packState() layout) padded to a multiple of 8.
+// Frames hold every slot of the container, so with TrajectoryFlags a reader
+// can tell the inactive slots apart. Everything is native endian and every
+// array starts 8-byte aligned, so a mapped file can be read in place.
+enum TrajectoryField : uint32_t {
+    TrajectoryPositions = 1,  // Always present
+    TrajectoryVelocities = 2,
+    TrajectoryFlags = 4
+};
+
+struct trajectory_header {
+    char magic[8] = {'P', 'T', 'R', 'A', 'J', 0, 0, 0};
+    uint32_t version = 1;
+    uint32_t fields = TrajectoryPositions;
+    uint64_t frames = 0;  // Filled in on close; 0 if the writer never closed
+    double dt = 0.0;      // Time step of the simulation
+    uint64_t reserved[4] = {};
+};
+static_assert(sizeof(trajectory_header) == 64, "trajectory_header must stay 64 bytes");
+
+struct frame_header {
+    uint64_t step;
+    uint64_t count;
+};
+
+// Bytes of one frame holding count particles, header included
+inline size_t trajectoryFrameBytes(uint32_t fields, size_t count) {
+    size_t bytes = sizeof(frame_header) + 2 * count * sizeof(double);
+    if (fields & TrajectoryVelocities) bytes += 2 * count * sizeof(double);
+    if (fields & TrajectoryFlags) bytes += (count + 7) & ~size_t(7);
+    return bytes;
+}
+
+// Lay out one frame of any container of Particle in buffer, gathering the
+// strided fields
+template <typename Container>
+void encodeFrame(uint64_t step, const Container& particles, uint32_t fields, std::vector<char>& buffer) {
+    size_t n = particles.size();
+    buffer.resize(trajectoryFrameBytes(fields, n));
+    char* out = buffer.data();
+    frame_header frame{step, n};
+    std::memcpy(out, &frame, sizeof(frame));
+    double* x = reinterpret_cast<double*>(out + sizeof(frame));
+    double* y = x + n;
+    double* vx = y + n;
+    double* vy = vx + n;
+    unsigned char* flags = reinterpret_cast<unsigned char*>((fields & TrajectoryVelocities) ? vy + n : vx);
+    size_t i = 0;
+    for (const auto& p : particles) {
+        x[i] = p.position[0];
+        y[i] = p.position[1];
+        if (fields & TrajectoryVelocities) {
+            vx[i] = p.velocity[0];
+            vy[i] = p.velocity[1];
+        }
+        if (fields & TrajectoryFlags) flags[i] = packState(p.wrapX, p.wrapY, p.active);
+        ++i;
+    }
+    if (fields & TrajectoryFlags) std::memset(flags + n, 0, ((n + 7) & ~size_t(7)) - n);
+}
+
+// The SoA arrays are already packed, so this is a straight copy of each
+inline void encodeFrame(uint64_t step, const particle_soa& particles, uint32_t fields, std::vector<char>& buffer) {
+    size_t n = particles.size();
+    buffer.resize(trajectoryFrameBytes(fields, n));
+    char* out = buffer.data();
+    frame_header frame{step, n};
+    std::memcpy(out, &frame, sizeof(frame));
+    out += sizeof(frame);
+    const double* arrays[4] = {particles.x, particles.y, particles.vx, particles.vy};
+    int narrays = (fields & TrajectoryVelocities) ? 4 : 2;
+    for (int a = 0; a < narrays; ++a) {
+        if (n) std::memcpy(out, arrays[a], n * sizeof(double));
+        out += n * sizeof(double);
+    }
+    if (fields & TrajectoryFlags) {
+        if (n) std::memcpy(out, particles.state, n);
+        std::memset(out + n, 0, ((n + 7) & ~size_t(7)) - n);
+    }
+}
+
+class trajectory_writer {
+public:
+    trajectory_writer(const std::string& path, uint32_t fields, double dt) {
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) throw std::runtime_error("trajectory_writer: cannot open " + path + ": " + std::strerror(errno));
+        header.fields = fields | TrajectoryPositions;
+        header.dt = dt;
+        writeAll(&header, sizeof(header));
+    }
+
+    trajectory_writer(const trajectory_writer&) = delete;
+    trajectory_writer& operator=(const trajectory_writer&) = delete;
+
+    ~trajectory_writer() {
+        try {
+            close();
+        } catch (...) {
+            // Destructors must not throw; an explicit close() reports errors
+        }
+    }
+
+    uint32_t fields() const { return header.fields; }
+    uint64_t frames() const { return header.frames; }
+
+    // Straight from the SoA arrays with one writev, no copies
+    void writeFrame(uint64_t step, const particle_soa& particles) {
+        size_t n = particles.size();
+        frame_header frame{step, n};
+        static const unsigned char zeros[8] = {};
+        iovec parts[7];
+        int count = 0;
+        parts[count++] = {&frame, sizeof(frame)};
+        parts[count++] = {particles.x, n * sizeof(double)};
+        parts[count++] = {particles.y, n * sizeof(double)};
+        if (header.fields & TrajectoryVelocities) {
+            parts[count++] = {particles.vx, n * sizeof(double)};
+            parts[count++] = {particles.vy, n * sizeof(double)};
+        }
+        if (header.fields & TrajectoryFlags) {
+            parts[count++] = {particles.state, n};
+            parts[count++] = {const_cast<unsigned char*>(zeros), ((n + 7) & ~size_t(7)) - n};
+        }
+        writeAllv(parts, count);
+        header.frames++;
+    }
+
+    // Any container of Particle: the strided fields are gathered into one
+    // reusable buffer and written with a single call
+    template <typename Container>
+    void writeFrame(uint64_t step, const Container& particles) {
+        encodeFrame(step, particles, header.fields, buffer);
+        iovec part{buffer.data(), buffer.size()};
+        writeEncoded(&part, 1);
+    }
+
+    // Append count frames laid out by encodeFrame(), one per iovec, with
+    // a single writev
+    void writeEncoded(iovec* frames, int count) {
+        writeAllv(frames, count);
+        header.frames += count;
+    }
+
+    // Record the frame count in the header and close the file
+    void close() {
+        if (fd < 0) return;
+        int f = fd;
+        fd = -1;
+        bool ok = ::pwrite(f, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header));
+        ok = (::close(f) == 0) && ok;
+        if (!ok) throw std::runtime_error(std::string("trajectory_writer: close failed: ") + std::strerror(errno));
+    }
+
+private:
+    int fd = -1;
+    trajectory_header header;
+    std::vector<char> buffer;
+
+    void writeAll(const void* data, size_t bytes) {
+        iovec part{const_cast<void*>(data), bytes};
+        writeAllv(&part, 1);
+    }
+
+    void writeAllv(iovec* parts, int count) {
+        ::writeAllv(fd, parts, count, "trajectory_writer");
+    }
+};
+
+// Maps a trajectory file read-only and indexes its frames, so any frame can
+// be read in place without going through the ones before it.
+// A file whose writer did not close still reads up to its last whole frame.
+class trajectory_reader {
+public:
+    struct frame {
+        uint64_t step;
+        size_t count;
+        const double *x, *y;
+        const double *vx = nullptr, *vy = nullptr;   // With TrajectoryVelocities
+        const unsigned char *flags = nullptr;        // With TrajectoryFlags
+    };
+
+    explicit trajectory_reader(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("trajectory_reader: cannot open " + path + ": " + std::strerror(errno));
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("trajectory_reader: cannot stat " + path);
+        }
+        bytes = static_cast<size_t>(st.st_size);
+        if (bytes < sizeof(trajectory_header)) {
+            ::close(fd);
+            throw std::runtime_error("trajectory_reader: " + path + " is too short");
+        }
+        void* p = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) throw std::runtime_error("trajectory_reader: cannot map " + path);
+        base = static_cast<const char*>(p);
+        std::memcpy(&header, base, sizeof(header));
+        if (std::memcmp(header.magic, trajectory_header().magic, sizeof(header.magic)) != 0 || header.version != 1) {
+            munmap(const_cast<char*>(base), bytes);
+            throw std::runtime_error("trajectory_reader: " + path + " is not a version 1 trajectory");
+        }
+
+        // Walk the frame headers only
+        size_t offset = sizeof(trajectory_header);
+        while (offset + sizeof(frame_header) <= bytes) {
+            const frame_header* f = reinterpret_cast<const frame_header*>(base + offset);
+            size_t size = trajectoryFrameBytes(header.fields, f->count);
+            if (offset + size > bytes) break; // Cut short
+            offsets.push_back(offset);
+            offset += size;
+        }
+    }
+
+    trajectory_reader(const trajectory_reader&) = delete;
+    trajectory_reader& operator=(const trajectory_reader&) = delete;
+
+    ~trajectory_reader() { munmap(const_cast<char*>(base), bytes); }
+
+    size_t frames() const { return offsets.size(); }
+    uint32_t fields() const { return header.fields; }
+    double dt() const { return header.dt; }
+
+    frame operator[](size_t i) const {
+        const char* p = base + offsets[i];
+        const frame_header* f = reinterpret_cast<const frame_header*>(p);
+        frame out;
+        out.step = f->step;
+        out.count = f->count;
+        const double* arrays = reinterpret_cast<const double*>(p + sizeof(frame_header));
+        out.x = arrays;
+        out.y = arrays + out.count;
+        const double* next = arrays + 2 * out.count;
+        if (header.fields & TrajectoryVelocities) {
+            out.vx = next;
+            out.vy = next + out.count;
+            next += 2 * out.count;
+        }
+        if (header.fields & TrajectoryFlags) out.flags = reinterpret_cast<const unsigned char*>(next);
+        return out;
+    }
+
+private:
+    const char* base = nullptr;
+    size_t bytes = 0;
+    trajectory_header header;
+    std::vector<size_t> offsets; // Start of each frame
+};
+
+#endif
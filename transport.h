@@ -0,0 +1,236 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+#include <cstddef> //needed for size_t
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <new>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef USE_MPI
+#include <mpi.h>
+#endif
+#include "particle.h"
+
+// Exchange of migration batches between ranks that each own one x-slab of
+// the periodic box, so every rank only talks to its left and right
+// neighbour. start() hands over the outgoing batches and returns without
+// waiting for them to be delivered; finish() waits for the batches sent to
+// this rank in the same step and appends them. Work done between the two
+// overlaps with the transfer.
+class migration_transport {
+public:
+    virtual ~migration_transport() = default;
+    virtual int rank() const = 0;
+    virtual int size() const = 0;
+    virtual void start(const std::vector<Particle>& toLeft, const std::vector<Particle>& toRight) = 0;
+    virtual void finish(std::vector<Particle>& received) = 0;
+    // Sum of value over all ranks, returned on every rank
+    virtual double sum(double value) = 0;
+
+    int left() const { return (rank() + size() - 1) % size(); }
+    int right() const { return (rank() + 1) % size(); }
+};
+
+// Ranks are processes forked from one parent on the same machine and
+// batches go through mailboxes in a shared anonymous mapping.
+// Each rank has one mailbox per direction of travel, written only by its
+// neighbour on that side. A mailbox holds one batch at a time: the sender
+// waits until the previous batch has been taken, copies the records in and
+// publishes the step number; the receiver waits for that step number.
+class loopback_transport : public migration_transport {
+public:
+    // capacity is the largest batch a mailbox can hold
+    loopback_transport(int ranks, size_t capacity) : nranks(ranks), capacity(capacity) {
+        mailboxBytes = (sizeof(mailbox) + capacity * sizeof(Particle) + 63) & ~size_t(63);
+        headerBytes = (sizeof(shared_state) + sizeof(double) * nranks + 63) & ~size_t(63);
+        mappedBytes = headerBytes + 2 * nranks * mailboxBytes;
+        void* p = mmap(nullptr, mappedBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) throw std::bad_alloc();
+        base = static_cast<char*>(p);
+        new (base) shared_state();
+        for (int r = 0; r < nranks; ++r) {
+            for (int d = 0; d < 2; ++d) new (box(r, d)) mailbox();
+        }
+    }
+
+    loopback_transport(const loopback_transport&) = delete;
+    loopback_transport& operator=(const loopback_transport&) = delete;
+
+    ~loopback_transport() {
+        munmap(base, mappedBytes);
+    }
+
+    // Fork ranks 1 .. size()-1. Returns in every process with rank() set;
+    // the parent is rank 0.
+    void launch() {
+        for (int r = 1; r < nranks; ++r) {
+            pid_t pid = fork();
+            if (pid < 0) throw std::runtime_error("loopback_transport: fork failed");
+            if (pid == 0) {
+                myRank = r;
+                children.clear();
+                return;
+            }
+            children.push_back(pid);
+        }
+        myRank = 0;
+    }
+
+    // Rank 0 waits for the other ranks; they exit
+    void shutdown() {
+        if (myRank != 0) {
+            _exit(0);
+        }
+        for (pid_t pid : children) waitpid(pid, nullptr, 0);
+        children.clear();
+    }
+
+    int rank() const override { return myRank; }
+    int size() const override { return nranks; }
+
+    void start(const std::vector<Particle>& toLeft, const std::vector<Particle>& toRight) override {
+        step++;
+        post(box(left(), Leftward), toLeft);
+        post(box(right(), Rightward), toRight);
+    }
+
+    void finish(std::vector<Particle>& received) override {
+        // Batches travelling right come from the left neighbour and vice versa
+        take(box(myRank, Rightward), received);
+        take(box(myRank, Leftward), received);
+    }
+
+    double sum(double value) override {
+        double* values = reinterpret_cast<double*>(base + sizeof(shared_state));
+        values[myRank] = value;
+        barrier();
+        double total = 0.0;
+        for (int r = 0; r < nranks; ++r) total += values[r];
+        barrier(); // Nobody overwrites values until everyone has read them
+        return total;
+    }
+
+private:
+    enum Direction { Leftward = 0, Rightward = 1 };
+
+    struct alignas(64) mailbox {
+        std::atomic<uint64_t> posted{0};   // Step of the batch in the box
+        std::atomic<uint64_t> consumed{0}; // Last step the receiver has taken
+        size_t count = 0;
+        // Particle records follow
+    };
+
+    struct alignas(64) shared_state {
+        std::atomic<uint64_t> arrived{0};
+        std::atomic<uint64_t> generation{0};
+    };
+
+    int nranks;
+    size_t capacity;
+    size_t mailboxBytes, headerBytes, mappedBytes;
+    char* base = nullptr;
+    int myRank = 0;
+    uint64_t step = 0;
+    uint64_t barriers = 0;
+    std::vector<pid_t> children;
+
+    shared_state& state() { return *reinterpret_cast<shared_state*>(base); }
+
+    mailbox* box(int rank, int direction) {
+        return reinterpret_cast<mailbox*>(base + headerBytes + (2 * rank + direction) * mailboxBytes);
+    }
+
+    static Particle* records(mailbox* m) {
+        return reinterpret_cast<Particle*>(reinterpret_cast<char*>(m) + sizeof(mailbox));
+    }
+
+    void post(mailbox* m, const std::vector<Particle>& batch) {
+        if (batch.size() > capacity) throw std::length_error("loopback_transport: batch exceeds mailbox capacity");
+        while (m->consumed.load(std::memory_order_acquire) != step - 1) std::this_thread::yield();
+        m->count = batch.size();
+        if (!batch.empty()) std::memcpy(records(m), batch.data(), batch.size() * sizeof(Particle));
+        m->posted.store(step, std::memory_order_release);
+    }
+
+    void take(mailbox* m, std::vector<Particle>& received) {
+        while (m->posted.load(std::memory_order_acquire) != step) std::this_thread::yield();
+        received.insert(received.end(), records(m), records(m) + m->count);
+        m->consumed.store(step, std::memory_order_release);
+    }
+
+    // Generation-counting barrier across the forked ranks
+    void barrier() {
+        shared_state& s = state();
+        uint64_t target = ++barriers;
+        if (s.arrived.fetch_add(1, std::memory_order_acq_rel) + 1 == static_cast<uint64_t>(nranks)) {
+            s.arrived.store(0, std::memory_order_relaxed);
+            s.generation.store(target, std::memory_order_release);
+        } else {
+            while (s.generation.load(std::memory_order_acquire) < target) std::this_thread::yield();
+        }
+    }
+};
+
+#ifdef USE_MPI
+// Ranks are MPI processes. Batches are sent as raw Particle bytes with
+// nonblocking sends; the tag says which way the batch travels, so two ranks
+// that are each other's left and right neighbour still tell them apart.
+// The caller owns MPI_Init/MPI_Finalize.
+class mpi_transport : public migration_transport {
+public:
+    explicit mpi_transport(MPI_Comm comm = MPI_COMM_WORLD) : comm(comm) {
+        MPI_Comm_rank(comm, &myRank);
+        MPI_Comm_size(comm, &nranks);
+    }
+
+    int rank() const override { return myRank; }
+    int size() const override { return nranks; }
+
+    void start(const std::vector<Particle>& toLeft, const std::vector<Particle>& toRight) override {
+        // Keep our own copies: the caller may reuse its vectors before finish()
+        sendLeft = toLeft;
+        sendRight = toRight;
+        MPI_Isend(sendLeft.data(), static_cast<int>(sendLeft.size() * sizeof(Particle)), MPI_BYTE,
+                  left(), Leftward, comm, &requests[0]);
+        MPI_Isend(sendRight.data(), static_cast<int>(sendRight.size() * sizeof(Particle)), MPI_BYTE,
+                  right(), Rightward, comm, &requests[1]);
+    }
+
+    void finish(std::vector<Particle>& received) override {
+        receive(left(), Rightward, received);
+        receive(right(), Leftward, received);
+        MPI_Waitall(2, requests, MPI_STATUSES_IGNORE);
+    }
+
+    double sum(double value) override {
+        double total = 0.0;
+        MPI_Allreduce(&value, &total, 1, MPI_DOUBLE, MPI_SUM, comm);
+        return total;
+    }
+
+private:
+    enum Direction { Leftward = 0, Rightward = 1 };
+
+    MPI_Comm comm;
+    int myRank = 0, nranks = 1;
+    std::vector<Particle> sendLeft, sendRight;
+    MPI_Request requests[2];
+
+    void receive(int source, int tag, std::vector<Particle>& received) {
+        MPI_Status status;
+        MPI_Probe(source, tag, comm, &status);
+        int bytes = 0;
+        MPI_Get_count(&status, MPI_BYTE, &bytes);
+        size_t offset = received.size();
+        received.resize(offset + bytes / sizeof(Particle));
+        MPI_Recv(received.data() + offset, bytes, MPI_BYTE, source, tag, comm, MPI_STATUS_IGNORE);
+    }
+};
+#endif
+
+#endif